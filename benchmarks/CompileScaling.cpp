@@ -0,0 +1,325 @@
+// Measures how add_source_code + compile scale with size and shape of generated C sources.
+// Usage: CompileScaling [--format=csv|json] [--max-lines=N] [--headers-dir=PATH]
+
+#include <TccWrapper.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TW_BENCH_FORK
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /// Shape of generated source
+    struct Config
+    {
+        char const* dimension;
+        std::size_t functions;
+        std::size_t statements;
+        std::size_t strings;
+        std::size_t header_depth;
+        std::size_t globals;
+    };
+
+    /// Measurements of single configuration, plain struct so it can be passed through pipe
+    struct Result
+    {
+        std::size_t lines;
+        std::size_t bytes;
+        double add_source_ms;
+        double compile_ms;
+        long peak_rss_kb;
+        std::size_t image_bytes;
+        bool ok;
+    };
+
+    /// Deterministic linear congruential generator, same sources on every run and platform
+    struct Random
+    {
+        uint64_t state;
+
+        uint32_t next() noexcept
+        {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+
+            return static_cast<uint32_t>(state >> 33);
+        }
+    };
+
+    /// Write chain of headers header_0.h -> ... -> header_{depth-1}.h, each declaring its share of functions
+    void write_headers(std::filesystem::path const& dir, Config const& config, std::size_t& lines)
+    {
+        std::filesystem::create_directories(dir);
+
+        for (std::size_t level = 0; level < config.header_depth; ++level)
+        {
+            std::ofstream file{ dir / ("header_" + std::to_string(level) + ".h") };
+
+            file << "#ifndef HEADER_" << level << "_H\n#define HEADER_" << level << "_H\n";
+            lines += 2;
+
+            if (level + 1 < config.header_depth)
+            {
+                file << "#include \"header_" << level + 1 << ".h\"\n";
+                ++lines;
+            }
+
+            for (std::size_t i = level; i < config.functions; i += config.header_depth)
+            {
+                file << "int fn_" << i << "(int x);\n";
+                ++lines;
+            }
+
+            file << "#endif\n";
+            ++lines;
+        }
+    }
+
+    /// Generate translation unit for given configuration
+    std::string generate_source(Config const& config, uint64_t seed, std::size_t& lines)
+    {
+        Random random{ seed };
+        std::string src;
+
+        src.reserve(config.functions * (config.statements + config.strings + 4) * 40 + config.globals * 32);
+
+        if (config.header_depth > 0)
+        {
+            src += "#include \"header_0.h\"\n";
+            ++lines;
+        }
+
+        src += "static int length(char const* s) { int n = 0; while (s[n]) ++n; return n; }\n";
+        ++lines;
+
+        for (std::size_t i = 0; i < config.globals; ++i)
+        {
+            src += "int global_" + std::to_string(i) + " = " + std::to_string(random.next() % 1000) + ";\n";
+            ++lines;
+        }
+
+        for (std::size_t i = 0; i < config.functions; ++i)
+        {
+            src += "int fn_" + std::to_string(i) + "(int x)\n{\n";
+            lines += 2;
+
+            for (std::size_t j = 0; j < config.statements; ++j)
+            {
+                switch (random.next() % 4)
+                {
+                    case 0:  src += "    x = x * " + std::to_string(random.next() % 97 + 3) + " + " + std::to_string(j) + ";\n"; break;
+                    case 1:  src += "    if (x & " + std::to_string(1u << (random.next() % 16)) + ") x ^= " + std::to_string(random.next()) + ";\n"; break;
+                    case 2:  src += "    x += x >> " + std::to_string(random.next() % 13 + 1) + ";\n"; break;
+                    default: src += (i > 0) ? "    x += fn_" + std::to_string(random.next() % i) + "(x & 7) & 1;\n" : "    ++x;\n"; break;
+                }
+
+                ++lines;
+            }
+
+            for (std::size_t j = 0; j < config.strings; ++j)
+            {
+                src += "    x += length(\"";
+
+                for (auto k = random.next() % 48 + 16; k > 0; --k)
+                {
+                    src += static_cast<char>('a' + random.next() % 26);
+                }
+
+                src += "\");\n";
+                ++lines;
+            }
+
+            src += "    return x;\n}\n";
+            lines += 2;
+        }
+
+        return src;
+    }
+
+    /// Compile single configuration in current process
+    Result run(Config const& config, uint64_t seed, std::filesystem::path const& headers_dir)
+    {
+        Result result{};
+
+        auto const dir = headers_dir / std::to_string(seed);
+
+        if (config.header_depth > 0)
+        {
+            write_headers(dir, config, result.lines);
+        }
+
+        auto const src = generate_source(config, seed, result.lines);
+        result.bytes = src.size();
+
+        auto tcc = tw::TccWrapper{};
+
+        tcc.create_state();
+        tcc.set_error_callback(nullptr, +[](void*, char const* msg) { std::fprintf(stderr, "%s\n", msg); });
+        tcc.add_include_path(dir.string().c_str());
+
+        auto const start = std::chrono::steady_clock::now();
+
+        result.ok = tcc.add_source_code(src.c_str());
+
+        auto const compiled = std::chrono::steady_clock::now();
+
+        // Same two relocation passes as compile() does with TCC_RELOCATE_AUTO, done here to learn size of relocated image
+        auto const state = tcc.get_state();
+        auto const size = result.ok ? tcc_relocate(state, nullptr) : -1;
+        auto const image = std::unique_ptr<void, decltype(&std::free)>{ size > 0 ? std::malloc(static_cast<std::size_t>(size)) : nullptr, &std::free };
+
+        result.ok = image != nullptr && tcc_relocate(state, image.get()) != -1;
+
+        auto const end = std::chrono::steady_clock::now();
+
+        result.add_source_ms = std::chrono::duration<double, std::milli>(compiled - start).count();
+        result.compile_ms = std::chrono::duration<double, std::milli>(end - compiled).count();
+        result.image_bytes = result.ok ? static_cast<std::size_t>(size) : 0;
+
+        #if defined(TW_BENCH_FORK)
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        result.peak_rss_kb = usage.ru_maxrss;
+        #endif
+
+        return result;
+    }
+
+    /// Compile configuration in child process (when available) so peak RSS belongs to single configuration
+    Result run_isolated(Config const& config, uint64_t seed, std::filesystem::path const& headers_dir)
+    {
+        #if defined(TW_BENCH_FORK)
+        int fds[2];
+
+        if (pipe(fds) == 0)
+        {
+            if (auto const pid = fork(); pid == 0)
+            {
+                auto const result = run(config, seed, headers_dir);
+                auto const written = write(fds[1], &result, sizeof(result));
+
+                _exit(written == static_cast<ssize_t>(sizeof(result)) ? 0 : 1);
+            }
+            else if (pid > 0)
+            {
+                close(fds[1]);
+
+                Result result{};
+                auto const received = read(fds[0], &result, sizeof(result));
+
+                close(fds[0]);
+                waitpid(pid, nullptr, 0);
+
+                return received == static_cast<ssize_t>(sizeof(result)) ? result : Result{};
+            }
+
+            close(fds[0]);
+            close(fds[1]);
+        }
+        #endif
+
+        return run(config, seed, headers_dir);
+    }
+
+    /// Build configurations varying one dimension at a time, each scaled from 1K lines up to max_lines, header depth at fixed size
+    std::vector<Config> make_configs(std::size_t max_lines)
+    {
+        std::vector<Config> configs;
+
+        for (std::size_t lines = 1000; lines <= max_lines; lines *= 10)
+        {
+            configs.push_back({ "function_count", lines / 12, 8, 0, 0, 0 });
+            configs.push_back({ "function_size", 10, lines / 10, 0, 0, 0 });
+            configs.push_back({ "string_literals", lines / 36, 2, 30, 0, 0 });
+            configs.push_back({ "symbol_count", 10, 8, 0, 0, lines });
+        }
+
+        for (auto const depth : { std::size_t{ 1 }, std::size_t{ 4 }, std::size_t{ 16 }, std::size_t{ 64 } })
+        {
+            configs.push_back({ "header_depth", 2000, 8, 0, depth, 0 });
+        }
+
+        return configs;
+    }
+}
+
+auto main(int argc, char** argv) -> int
+{
+    auto is_json = false;
+    std::size_t max_lines = 1000000;
+    auto headers_dir = std::filesystem::temp_directory_path() / "tw_compile_scaling";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--format=json") == 0)
+        {
+            is_json = true;
+        }
+        else if (std::strncmp(argv[i], "--max-lines=", 12) == 0)
+        {
+            max_lines = std::stoul(argv[i] + 12);
+        }
+        else if (std::strncmp(argv[i], "--headers-dir=", 14) == 0)
+        {
+            headers_dir = argv[i] + 14;
+        }
+        else if (std::strcmp(argv[i], "--format=csv") != 0)
+        {
+            std::fprintf(stderr, "usage: %s [--format=csv|json] [--max-lines=N] [--headers-dir=PATH]\n", argv[0]);
+
+            return 1;
+        }
+    }
+
+    auto const configs = make_configs(max_lines);
+
+    if (is_json)
+    {
+        std::printf("[\n");
+    }
+    else
+    {
+        std::printf("dimension,functions,statements,strings,header_depth,globals,lines,bytes,add_source_ms,compile_ms,lines_per_s,peak_rss_kb,image_bytes,ok\n");
+    }
+
+    for (std::size_t i = 0; i < configs.size(); ++i)
+    {
+        auto const& config = configs[i];
+        auto const result = run_isolated(config, i + 1, headers_dir);
+        auto const total_ms = result.add_source_ms + result.compile_ms;
+        auto const lines_per_s = total_ms > 0.0 ? static_cast<double>(result.lines) * 1000.0 / total_ms : 0.0;
+
+        std::printf(is_json
+            ? "  {\"dimension\":\"%s\",\"functions\":%zu,\"statements\":%zu,\"strings\":%zu,\"header_depth\":%zu,\"globals\":%zu,\"lines\":%zu,\"bytes\":%zu,"
+              "\"add_source_ms\":%.3f,\"compile_ms\":%.3f,\"lines_per_s\":%.0f,\"peak_rss_kb\":%ld,\"image_bytes\":%zu,\"ok\":%s}%s\n"
+            : "%s,%zu,%zu,%zu,%zu,%zu,%zu,%zu,%.3f,%.3f,%.0f,%ld,%zu,%s%s\n",
+            config.dimension, config.functions, config.statements, config.strings, config.header_depth, config.globals,
+            result.lines, result.bytes, result.add_source_ms, result.compile_ms, lines_per_s, result.peak_rss_kb, result.image_bytes,
+            result.ok ? "true" : "false", (is_json && i + 1 < configs.size()) ? "," : ""
+        );
+
+        std::fflush(stdout);
+    }
+
+    if (is_json)
+    {
+        std::printf("]\n");
+    }
+
+    std::error_code ec;
+    std::filesystem::remove_all(headers_dir, ec);
+
+    return 0;
+}
@@ -0,0 +1,27 @@
+#include <TccWrapper.hpp>
+
+#include <cassert>
+
+auto main() -> int
+{
+    auto tcc = tw::TccWrapper{};
+
+    tcc.create_state();
+
+    tcc.register_kernels();
+
+    tcc.add_source_code(R"(
+        double norm2(double const* x, int n)
+        {
+            return tw_dot_f64(x, x, n);
+        }
+    )");
+
+    tcc.compile();
+
+    double const values[] = { 1.0, 2.0, 3.0, 4.0, 5.0 };
+
+    assert(tcc.invoke<double(double const*, int)>("norm2", values, 5) == 55.0);
+
+    return 0;
+}
@@ -0,0 +1,30 @@
+#include <TccWrapper.hpp>
+
+#include <cassert>
+
+auto main() -> int
+{
+    auto tcc = tw::TccWrapper{};
+
+    tcc.create_state();
+
+    tcc.add_file("fibonacci.c");
+
+    auto const object = tcc.output_to_memory(tw::OutputType::Object);
+
+    assert(!object.empty());
+
+    auto linker = tw::TccWrapper{};
+
+    linker.create_state();
+
+    linker.add_object_from_memory(object.data(), object.size());
+
+    linker.compile();
+
+    auto fibonacci = linker.get_function<int(int)>("fibonacci");
+
+    assert(fibonacci(9) == 34);
+
+    return 0;
+}
@@ -0,0 +1,25 @@
+#include <TccWrapper.hpp>
+
+#include <cassert>
+
+auto main() -> int
+{
+    auto tcc = tw::TccWrapper{};
+
+    tcc.create_state();
+
+    tcc.add_file("parallel.c");
+
+    tcc.compile();
+
+    auto twice = tcc.invoke_async<int(int)>("twice", 21);
+
+    auto sum = tcc.parallel_invoke<double(std::size_t, std::size_t)>("squares_sum", { 0, 1000 }, 64, 0.0, [](double acc, double partial) {
+        return acc + partial;
+    });
+
+    assert(twice.get() == 42);
+    assert(sum == 332833500.0);
+
+    return 0;
+}
@@ -0,0 +1,31 @@
+#include <TccWrapper.hpp>
+
+#include <iostream>
+
+auto main() -> int
+{
+    auto tcc = tw::TccWrapper{};
+
+    tcc.create_state();
+
+    tcc.add_file("fibonacci.c");
+
+    tcc.compile();
+
+    auto& profiler = tw::Profiler::get();
+
+    profiler.start();
+
+    auto sum = 0;
+
+    for (int i = 0; i < 10; ++i)
+    {
+        sum += tcc.invoke<int(int)>("fibonacci", 30);
+    }
+
+    profiler.stop();
+
+    profiler.write_report(std::cout);
+
+    return sum == 10 * 832040 ? 0 : 1;
+}
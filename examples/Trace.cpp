@@ -0,0 +1,23 @@
+#include <TccWrapper.hpp>
+
+#include <cassert>
+
+auto main() -> int
+{
+    tw::Tracer::get().enable();
+
+    auto tcc = tw::TccWrapper{};
+
+    tcc.create_state();
+
+    tcc.add_file("fibonacci.c");
+
+    tcc.compile();
+
+    assert(tcc.invoke<int(int)>("fibonacci", 9) == 34);
+
+    tw::Tracer::get().disable();
+
+    // open in chrome://tracing or ui.perfetto.dev
+    return tw::Tracer::get().save_chrome_trace("trace.json") ? 0 : 1;
+}
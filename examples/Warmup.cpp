@@ -0,0 +1,54 @@
+#include <TccWrapper.hpp>
+
+#include <cassert>
+#include <cstdio>
+
+auto main() -> int
+{
+    // previous run: record what was compiled and how often
+    {
+        auto manifest = tw::WarmupManifest{};
+
+        for (int i = 0; i < 10; ++i)
+        {
+            manifest.record_file("fibonacci.c");
+        }
+
+        manifest.record_file("hello.c", "-DUNUSED=1");
+
+        manifest.save("warmup.twwm");
+    }
+
+    // startup: compile recorded working set in background before first request
+    auto manifest = tw::WarmupManifest{};
+
+    manifest.load("warmup.twwm");
+
+    auto replayer = tw::WarmupReplayer{};
+
+    replayer.start(manifest);
+
+    replayer.wait();
+
+    // first request: use warm wrapper or compile on demand
+    auto tcc = replayer.take_file("fibonacci.c");
+
+    if (!tcc.is_valid())
+    {
+        tcc.create_state();
+
+        tcc.add_file("fibonacci.c");
+
+        tcc.compile();
+    }
+
+    auto fibonacci = tcc.get_function<int(int)>("fibonacci");
+
+    assert(fibonacci(9) == 34);
+
+    auto const report = replayer.get_first_request_report();
+
+    std::printf("%zu/%zu entries warm (%.0f%% of uses) after %lld us\n", report.warm_count, report.entries_count, report.get_warm_ratio() * 100.0, static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(report.elapsed).count()));
+
+    return 0;
+}
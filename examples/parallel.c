@@ -0,0 +1,18 @@
+typedef __SIZE_TYPE__ size_t;
+
+double squares_sum(size_t begin, size_t end)
+{
+    double sum = 0.0;
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        sum += (double)i * (double)i;
+    }
+
+    return sum;
+}
+
+int twice(int n)
+{
+    return n * 2;
+}
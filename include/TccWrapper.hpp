@@ -3,6 +3,19 @@
 
     Define TW_USE_EXCEPTIONS to use with_state/invoke methods
     Define TW_USE_OPTIONAL to use opt_with_state/opt_invoke methods
+    Define TW_USE_EXECUTOR to use Executor class and invoke_async/parallel_invoke methods
+    Define TW_USE_KERNELS to use register_kernels method (vectorized array kernels callable from scripts)
+    Define TW_USE_TRACER to use Tracer class (timeline of wrapper calls in Chrome trace format)
+    Define TW_USE_EMBEDDED_RUNTIME to make compile() link with -nostdlib and runtime helpers (libtcc1) provided by host,
+    so it does no library lookups (alloca is not provided, libc symbols still resolve from host process),
+    output_file/output_to_memory are unaffected and link crt, libc and libtcc1 from disk as usual
+    Define TW_USE_PROFILER to use Profiler class (SIGPROF sampling of compiled code, Linux only, link with -lrt on older glibc)
+    Define TW_USE_MEMORY_OUTPUT to use output_to_memory/add_object_from_memory methods
+    Define TW_USE_WARMUP to use WarmupManifest/WarmupReplayer classes (record compile working set, precompile it on startup)
+
+    Thread safety: compiled code may be invoked from many threads at once, but compilation is not thread-safe
+    in tcc, with TW_USE_EXECUTOR or TW_USE_WARMUP defined every tcc call made by the wrapper on a state is serialized,
+    except symbol lookup (get_symbol and methods using it) which only reads the state's own symbol table
 
     Created by Patrick Stritch
 */
@@ -17,18 +30,112 @@
 
 // C++
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
+#include <string>
 #include <utility>
 
-#if defined(TW_USE_EXCEPTIONS)
+#if defined(TW_USE_EXCEPTIONS) || defined(TW_USE_EXECUTOR)
 #include <stdexcept>
-#include <string>
+#endif
+
+#if defined(TW_USE_EXECUTOR)
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <vector>
 #endif
 
 #if defined(TW_USE_OPTIONAL)
 #include <optional>
 #endif
 
+#if defined(TW_USE_KERNELS)
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define TW_PRIV_KERNELS_X64
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define TW_PRIV_TARGET_AVX2
+#else
+#define TW_PRIV_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+#endif
+
+#if defined(TW_USE_TRACER)
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+#endif
+
+#if defined(TW_USE_PROFILER)
+#if !defined(__linux__)
+#error TW_USE_PROFILER is supported only on Linux
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include <cstdlib>
+
+#include <dirent.h>
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#endif
+
+#if defined(TW_USE_MEMORY_OUTPUT)
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+#endif
+
+#if defined(TW_USE_WARMUP)
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#endif
+
 // tinycc
 #include <libtcc.h>
 
@@ -358,374 +465,3162 @@ namespace tw
         {
             return as_free_function<decltype(vMethodPtr), vMethodPtr>();
         }
-    }
-
-    /// Enumeration that specifies how compiled code will be outputed
-    enum class OutputType : int32_t
-    {
-        Dll        = TCC_OUTPUT_DLL,
-        Executable = TCC_OUTPUT_EXE,
-        Object     = TCC_OUTPUT_OBJ
-    };
 
-    /// Wrapper around tcc state with set of useful methods
-    class TccWrapper
-    {
-    public:
+        /// Scoped guard serializing tcc calls (libtcc keeps preprocessor and linker state in globals), no-op without TW_USE_EXECUTOR or TW_USE_WARMUP
+        struct CompileLock
+        {
+            #if defined(TW_USE_EXECUTOR) || defined(TW_USE_WARMUP)
 
-        using State_t   = TCCState*;
-        using ErrorFn_t = void (*)(void* user_data, char const* msg);
+            /// Acquire process-wide compilation lock
+            CompileLock() noexcept
+            {
+                get_mutex().lock();
+            }
 
-        /// Create wrapper object from (possibly) existing state
-        static TccWrapper from(State_t state)
-        {
-            return TccWrapper{ state };
-        }
+            /// Release process-wide compilation lock
+            ~CompileLock() noexcept
+            {
+                get_mutex().unlock();
+            }
 
-        /// Deleted named-ctor to prevent construction from nullptr
-        static TccWrapper from(std::nullptr_t) = delete;
+            /// Deleted copy-ctor
+            CompileLock(CompileLock const&) = delete;
 
-        #if defined(TW_USE_EXCEPTIONS)
+            /// Deleted copy-assign-op
+            CompileLock& operator=(CompileLock const&) = delete;
 
-        /// Create wrapper object with valid state or throw on failure
-        static TccWrapper with_state()
-        {
-            if (auto state = tcc_new())
+            /// Return mutex shared by all wrappers
+            static std::mutex& get_mutex() noexcept
             {
-                return TccWrapper{ state };
-            }
+                static std::mutex mutex;
 
-            throw std::runtime_error("TccWrapper::with_state() - unable to create tcc state");
-        }
+                return mutex;
+            }
 
-        #endif
+            #endif
+        };
 
-        #if defined(TW_USE_OPTIONAL)
+        #if defined(TW_USE_EMBEDDED_RUNTIME)
 
-        /// Create optional of wrapper object with valid state or empty optional on failure
-        static std::optional<TccWrapper> opt_with_state()
+        /// Host implementations of libtcc1 helpers, registered instead of linking libtcc1.a from disk
+        namespace runtime
         {
-            if (auto state = tcc_new())
+            inline uint64_t fixunssfdi(float a) noexcept { return static_cast<uint64_t>(a); }
+            inline uint64_t fixunsdfdi(double a) noexcept { return static_cast<uint64_t>(a); }
+            inline uint64_t fixunsxfdi(long double a) noexcept { return static_cast<uint64_t>(a); }
+            inline int64_t fixsfdi(float a) noexcept { return static_cast<int64_t>(a); }
+            inline int64_t fixdfdi(double a) noexcept { return static_cast<int64_t>(a); }
+            inline int64_t fixxfdi(long double a) noexcept { return static_cast<int64_t>(a); }
+            inline float floatundisf(uint64_t a) noexcept { return static_cast<float>(a); }
+            inline double floatundidf(uint64_t a) noexcept { return static_cast<double>(a); }
+            inline long double floatundixf(uint64_t a) noexcept { return static_cast<long double>(a); }
+            inline float floatdisf(int64_t a) noexcept { return static_cast<float>(a); }
+            inline double floatdidf(int64_t a) noexcept { return static_cast<double>(a); }
+            inline long double floatdixf(int64_t a) noexcept { return static_cast<long double>(a); }
+            inline int64_t divdi3(int64_t a, int64_t b) noexcept { return a / b; }
+            inline int64_t moddi3(int64_t a, int64_t b) noexcept { return a % b; }
+            inline uint64_t udivdi3(uint64_t a, uint64_t b) noexcept { return a / b; }
+            inline uint64_t umoddi3(uint64_t a, uint64_t b) noexcept { return a % b; }
+            inline int64_t ashldi3(int64_t a, int32_t b) noexcept { return static_cast<int64_t>(static_cast<uint64_t>(a) << b); }
+            inline int64_t ashrdi3(int64_t a, int32_t b) noexcept { return a >> b; }
+            inline uint64_t lshrdi3(uint64_t a, int32_t b) noexcept { return a >> b; }
+            inline void* memcpy(void* dst, void const* src, std::size_t n) noexcept { return std::memcpy(dst, src, n); }
+            inline void* memmove(void* dst, void const* src, std::size_t n) noexcept { return std::memmove(dst, src, n); }
+            inline void* memset(void* dst, int32_t c, std::size_t n) noexcept { return std::memset(dst, c, n); }
+
+            #if defined(__x86_64__) && !defined(_WIN64)
+
+            /// va_list layout declared by tcc's include/stdarg.h for x86-64 SysV
+            struct VaList
             {
-                return TccWrapper{ state };
-            }
-
-            return std::nullopt;
-        }
+                uint32_t gp_offset;
+                uint32_t fp_offset;
+                char* overflow_arg_area;
+                char* reg_save_area;
+            };
+
+            /// Initialize va_list from frame of variadic function, register save area layout matches tcc's prologue
+            inline void va_list_start(VaList* ap, void* fp) noexcept
+            {
+                auto const frame = static_cast<char*>(fp);
 
-        #endif
+                uint32_t offsets[3];
+                std::memcpy(offsets, frame - 16, sizeof(offsets));
 
-        /// Create invalid (without state) wrapper object
-        TccWrapper() noexcept
-            : m_state { nullptr }
-        {}
+                ap->gp_offset = offsets[0];
+                ap->fp_offset = offsets[1];
+                ap->overflow_arg_area = frame + offsets[2];
+                ap->reg_save_area = frame - 176 - 16;
+            }
 
-        /// Deleted const copy-ctor
-        TccWrapper(TccWrapper const&) = delete;
+            /// Return address of next variadic argument of given class (0 - integer, 1 - sse, 2 - memory), size and alignment
+            inline void* va_list_arg(VaList* ap, int32_t arg_type, int32_t size, int32_t align) noexcept
+            {
+                auto const size_8 = static_cast<uint32_t>((size + 7) & ~7);
+                auto const align_8 = static_cast<uintptr_t>((align + 7) & ~7);
 
-        /// Deleted const copy-assign-op
-        TccWrapper& operator=(TccWrapper const&) = delete;
+                if (arg_type == 0 && ap->gp_offset + size_8 <= 48)
+                {
+                    ap->gp_offset += size_8;
 
-        /// Move-ctor
-        TccWrapper(TccWrapper&& other) noexcept
-            : m_state { std::exchange(other.m_state, nullptr) }
-        {}
+                    return ap->reg_save_area + ap->gp_offset - size_8;
+                }
 
-        /// Move-assign-op
-        TccWrapper& operator=(TccWrapper&& other) noexcept
-        {
-            if (this != &other)
-            {
-                if (is_valid())
+                if (arg_type == 1 && ap->fp_offset < 128 + 48)
                 {
-                    tcc_delete(m_state);
+                    ap->fp_offset += 16;
+
+                    return ap->reg_save_area + ap->fp_offset - 16;
                 }
 
-                m_state = std::exchange(other.m_state, nullptr);
+                auto const stack_size = (arg_type == 1) ? 8u : size_8;
+                auto const end = reinterpret_cast<uintptr_t>(ap->overflow_arg_area + stack_size);
+
+                ap->overflow_arg_area = reinterpret_cast<char*>((end + align_8 - 1) & ~(align_8 - 1));
+
+                return ap->overflow_arg_area - stack_size;
             }
 
-            return *this;
-        }
+            #endif
 
-        /// Destroy tcc state
-        ~TccWrapper() noexcept
-        {
-            if (is_valid())
+            /// Link state without libc/libtcc1 lookups (-nostdlib) and provide runtime helpers from host, only for compilation to memory
+            inline void install(TCCState* state) noexcept
             {
-                tcc_delete(m_state);
+                tcc_set_options(state, "-nostdlib");
+
+                tcc_add_symbol(state, "__fixunssfdi", bit_cast<void const*>(&fixunssfdi));
+                tcc_add_symbol(state, "__fixunsdfdi", bit_cast<void const*>(&fixunsdfdi));
+                tcc_add_symbol(state, "__fixunsxfdi", bit_cast<void const*>(&fixunsxfdi));
+                tcc_add_symbol(state, "__fixsfdi", bit_cast<void const*>(&fixsfdi));
+                tcc_add_symbol(state, "__fixdfdi", bit_cast<void const*>(&fixdfdi));
+                tcc_add_symbol(state, "__fixxfdi", bit_cast<void const*>(&fixxfdi));
+                tcc_add_symbol(state, "__floatundisf", bit_cast<void const*>(&floatundisf));
+                tcc_add_symbol(state, "__floatundidf", bit_cast<void const*>(&floatundidf));
+                tcc_add_symbol(state, "__floatundixf", bit_cast<void const*>(&floatundixf));
+                tcc_add_symbol(state, "__floatdisf", bit_cast<void const*>(&floatdisf));
+                tcc_add_symbol(state, "__floatdidf", bit_cast<void const*>(&floatdidf));
+                tcc_add_symbol(state, "__floatdixf", bit_cast<void const*>(&floatdixf));
+                tcc_add_symbol(state, "__divdi3", bit_cast<void const*>(&divdi3));
+                tcc_add_symbol(state, "__moddi3", bit_cast<void const*>(&moddi3));
+                tcc_add_symbol(state, "__udivdi3", bit_cast<void const*>(&udivdi3));
+                tcc_add_symbol(state, "__umoddi3", bit_cast<void const*>(&umoddi3));
+                tcc_add_symbol(state, "__ashldi3", bit_cast<void const*>(&ashldi3));
+                tcc_add_symbol(state, "__ashrdi3", bit_cast<void const*>(&ashrdi3));
+                tcc_add_symbol(state, "__lshrdi3", bit_cast<void const*>(&lshrdi3));
+                tcc_add_symbol(state, "memcpy", bit_cast<void const*>(&runtime::memcpy));
+                tcc_add_symbol(state, "memmove", bit_cast<void const*>(&runtime::memmove));
+                tcc_add_symbol(state, "memset", bit_cast<void const*>(&runtime::memset));
+
+                #if defined(__x86_64__) && !defined(_WIN64)
+                tcc_add_symbol(state, "__va_start", bit_cast<void const*>(&va_list_start));
+                tcc_add_symbol(state, "__va_arg", bit_cast<void const*>(&va_list_arg));
+                #endif
             }
         }
 
-        /// Create (or recreate) tcc state, return true on success
-        bool create_state() noexcept
-        {
-            if (is_valid())
-            {
-                tcc_delete(m_state);
-            }
+        #endif
 
-            m_state = tcc_new();
+        /// Create new tcc state under compilation lock
+        inline TCCState* new_state() noexcept
+        {
+            [[maybe_unused]] CompileLock const lock{};
 
-            return is_valid();
+            return tcc_new();
         }
 
-        /// Destroy tcc state, return true if it was deleted
-        void destroy_state() noexcept
+        /// Delete tcc state under compilation lock
+        inline void delete_state(TCCState* state) noexcept
         {
-            if (is_valid())
-            {
-                tcc_delete(m_state);
+            [[maybe_unused]] CompileLock const lock{};
 
-                m_state = nullptr;
-            }
+            tcc_delete(state);
         }
+    }
 
-        /// Set function for printing error messages
-        void set_error_callback(void* user_data, ErrorFn_t fn) const noexcept
-        {
-            tcc_set_error_func(m_state, user_data, fn);
-        }
+    /// Enumeration that specifies how compiled code will be outputed
+    enum class OutputType : int32_t
+    {
+        Dll        = TCC_OUTPUT_DLL,
+        Executable = TCC_OUTPUT_EXE,
+        Object     = TCC_OUTPUT_OBJ
+    };
 
-        /// Set options as from command line (like "-std=c99 -O2")
-        void set_options(char const* options) const noexcept
-        {
-            tcc_set_options(m_state, options);
-        }
+    #if defined(TW_USE_EXECUTOR)
 
-        /// Add include path (as with -Ipath)
-        void add_include_path(char const* path) const noexcept
-        {
-            tcc_add_include_path(m_state, path);
-        }
+    /// Half-open range of indices [begin, end) split into chunks by parallel_invoke
+    struct Range
+    {
+        std::size_t begin;
+        std::size_t end;
+    };
 
-        /// Add system include path (as with -isystem path)
-        void add_system_include_path(char const* path) const noexcept
-        {
-            tcc_add_sysinclude_path(m_state, path);
-        }
+    /// Work-stealing thread pool, workers pop own tasks LIFO and steal from others FIFO
+    class Executor
+    {
+    public:
 
-        /// Add library path (as with -Lpath)
-        void add_library_path(char const* path) const noexcept
-        {
-            tcc_add_library_path(m_state, path);
-        }
+        using Task_t = std::function<void()>;
 
-        /// Add library (as with -lname)
-        void add_library(char const* name) const noexcept
+        /// Return process-wide executor with one worker per hardware thread, created on first use
+        static Executor& get_default()
         {
-            tcc_add_library(m_state, name);
-        }
+            static Executor executor{ std::thread::hardware_concurrency() };
 
-        /// Add file { C file, dll, object, library, ld script } for compilation, return true on success
-        bool add_file(char const* path) const noexcept
-        {
-            return tcc_add_file(m_state, path) != -1;
+            return executor;
         }
 
-        /// Add null-terminated string containing C source for compilation, return true on success
-        bool add_source_code(char const* src) const noexcept
+        /// Spawn given number of workers (at least one)
+        explicit Executor(std::size_t workers_count)
+            : m_queues { std::make_unique<Queue[]>(std::max<std::size_t>(workers_count, 1)) }
+            , m_queues_count { std::max<std::size_t>(workers_count, 1) }
+            , m_pending { 0 }
+            , m_next_queue { 0 }
+            , m_stop { false }
         {
-            return tcc_compile_string(m_state, src) != -1;
+            m_workers.reserve(m_queues_count);
+
+            for (std::size_t i = 0; i < m_queues_count; ++i)
+            {
+                m_workers.emplace_back([this, i] { worker_loop(i); });
+            }
         }
 
-        /// Compile code to auto managed memory, return true on successful allocation, call only once
-        bool compile() const noexcept
-        {
-            tcc_set_output_type(m_state, TCC_OUTPUT_MEMORY);
+        /// Deleted copy-ctor
+        Executor(Executor const&) = delete;
 
-            return tcc_relocate(m_state, TCC_RELOCATE_AUTO) != -1;
-        }
+        /// Deleted copy-assign-op
+        Executor& operator=(Executor const&) = delete;
 
-        /// Define macro with given name and optional value (as with #define name value)
-        void define(char const* name, char const* value = nullptr) const noexcept
+        /// Finish already submitted tasks and join workers
+        ~Executor() noexcept
         {
-            tcc_define_symbol(m_state, name, value);
-        }
+            {
+                std::lock_guard<std::mutex> const lock{ m_sleep_mutex };
 
-        /// Undefine macro with given name (as with #undef name)
-        void undefine(char const* name) const noexcept
-        {
-            tcc_undefine_symbol(m_state, name);
-        }
+                m_stop = true;
+            }
 
-        /// Add symbol with given name
-        void add_symbol(char const* name, void const* symbol) const noexcept
-        {
-            tcc_add_symbol(m_state, name, symbol);
-        }
+            m_sleep_cv.notify_all();
 
-        /// Return void pointer to symbol with given name or nullptr if no such symbol exists
-        void* get_symbol(char const* name) const noexcept
-        {
-            return tcc_get_symbol(m_state, name);
+            for (auto& worker : m_workers)
+            {
+                worker.join();
+            }
         }
 
-        /// Return T pointer to symbol with given name or nullptr if no such symbol exists
-        template <typename T>
-        T* get_symbol_as(char const* name) const noexcept
+        /// Schedule task, tasks submitted from a worker go to its own queue, others are distributed round-robin
+        void submit(Task_t task)
         {
-            return priv::bit_cast<T*>(get_symbol(name));
-        }
+            auto const index = (t_owner == this) ? t_index : m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues_count;
 
-        /// Check if symbol with given name exists
-        bool has_symbol(char const* name) const noexcept
-        {
-            return get_symbol(name) != nullptr;
-        }
+            // count task before publishing it, so thief taking it right away never drops counter below zero
+            {
+                std::lock_guard<std::mutex> const lock{ m_sleep_mutex };
 
-        /// Register symbol from parameter as free function with given name, won't override if called multiple times
-        template <typename FP>
-        void register_function(char const* name, FP fn) const noexcept
-        {
-            if constexpr (priv::traits::FunctionPtr_v<FP>)
+                ++m_pending;
+            }
+
+            try
             {
-                tcc_add_symbol(m_state, name, priv::bit_cast<void const*>(fn));
+                std::lock_guard<std::mutex> const lock{ m_queues[index].mutex };
+
+                m_queues[index].tasks.push_back(std::move(task));
             }
-            else
+            catch (...)
             {
-                static_assert(priv::error<FP>, "FP is not a function pointer!");
+                m_pending.fetch_sub(1, std::memory_order_relaxed);
+
+                throw;
             }
-        }
 
-        /// Register symbol as free function with given name, won't override if called multiple times
-        template <typename F, F vFunctionPtr>
-        void register_function(char const* name) const noexcept
-        {
-            register_function(name, vFunctionPtr);
+            m_sleep_cv.notify_one();
         }
 
-        /// Register symbol as free function with given name, won't override if called multiple times
-        template <auto vFunctionPtr>
-        void register_function(char const* name) const noexcept
+        /// Run single pending task on calling thread, return true if any task was run
+        bool try_run_one()
         {
-            register_function(name, vFunctionPtr);
-        }
+            auto const first = (t_owner == this) ? t_index : 0;
 
-        /// Register symbol as class method with given name, won't override if called multiple times
-        template <typename MP, MP vMethodPtr>
-        void register_method(char const* name) const noexcept
-        {
-            if constexpr (priv::traits::MethodPtr_v<MP>)
+            for (std::size_t i = 0; i < m_queues_count; ++i)
             {
-                register_function(name, priv::as_free_function<MP, vMethodPtr>());
+                auto const index = (first + i) % m_queues_count;
+
+                if (auto task = pop_task(index, index == first && t_owner == this))
+                {
+                    task();
+
+                    return true;
+                }
             }
-            else
+
+            return false;
+        }
+
+        /// Help executing pending tasks until predicate returns true
+        template <typename Pred>
+        void help_until(Pred&& pred)
+        {
+            while (!pred())
             {
-                static_assert(priv::error<MP>, "MP is not a method pointer!");
+                if (!try_run_one())
+                {
+                    std::this_thread::yield();
+                }
             }
         }
 
-        /// Register symbol as class method with given name, won't override if called multiple times
-        template <auto vMethodPtr>
-        void register_method(char const* name) const noexcept
+        /// Return number of worker threads
+        std::size_t get_workers_count() const noexcept
         {
-            register_method<decltype(vMethodPtr), vMethodPtr>(name);
+            return m_queues_count;
         }
 
-        /// Return F pointer to function with given name or nullptr if no such symbol exists
-        template <typename F>
-        auto get_function(char const* name) const noexcept
+    private:
+
+        /// PRIV: Task queue owned by single worker
+        struct Queue
         {
-            if constexpr (priv::traits::Function_v<F>)
+            std::mutex mutex;
+            std::deque<Task_t> tasks;
+        };
+
+        /// PRIV: Take task from back of own queue or from front of other queue, return empty task if none
+        Task_t pop_task(std::size_t index, bool is_own)
+        {
+            Task_t task;
+
             {
-                return get_symbol_as<F>(name);
+                std::lock_guard<std::mutex> const lock{ m_queues[index].mutex };
+
+                auto& tasks = m_queues[index].tasks;
+
+                if (tasks.empty())
+                {
+                    return task;
+                }
+
+                if (is_own)
+                {
+                    task = std::move(tasks.back());
+                    tasks.pop_back();
+                }
+                else
+                {
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                }
+            }
+
+            m_pending.fetch_sub(1, std::memory_order_relaxed);
+
+            return task;
+        }
+
+        /// PRIV: Worker thread body
+        void worker_loop(std::size_t index)
+        {
+            t_owner = this;
+            t_index = index;
+
+            while (true)
+            {
+                if (try_run_one())
+                {
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock{ m_sleep_mutex };
+
+                m_sleep_cv.wait(lock, [this] { return m_stop || m_pending.load(std::memory_order_relaxed) > 0; });
+
+                if (m_stop && m_pending.load(std::memory_order_relaxed) == 0)
+                {
+                    return;
+                }
+            }
+        }
+
+        inline static thread_local Executor* t_owner = nullptr;
+        inline static thread_local std::size_t t_index = 0;
+
+        std::unique_ptr<Queue[]> m_queues;
+        std::size_t m_queues_count;
+        std::vector<std::thread> m_workers;
+        std::mutex m_sleep_mutex;
+        std::condition_variable m_sleep_cv;
+        std::atomic<std::size_t> m_pending;
+        std::atomic<std::size_t> m_next_queue;
+        bool m_stop;
+    };
+
+    #endif
+
+    #if defined(TW_USE_KERNELS)
+
+    namespace priv
+    {
+        namespace kernels
+        {
+            /// Scalar kernels, used as fallback and for tails of vectorized loops
+            namespace scalar
+            {
+                inline double sum_f64(double const* x, std::size_t n) noexcept
+                {
+                    double sum = 0.0;
+
+                    for (std::size_t i = 0; i < n; ++i)
+                    {
+                        sum += x[i];
+                    }
+
+                    return sum;
+                }
+
+                inline double dot_f64(double const* x, double const* y, std::size_t n) noexcept
+                {
+                    double sum = 0.0;
+
+                    for (std::size_t i = 0; i < n; ++i)
+                    {
+                        sum += x[i] * y[i];
+                    }
+
+                    return sum;
+                }
+
+                inline double min_f64(double const* x, std::size_t n) noexcept
+                {
+                    double value = std::numeric_limits<double>::infinity();
+
+                    for (std::size_t i = 0; i < n; ++i)
+                    {
+                        value = x[i] < value ? x[i] : value;
+                    }
+
+                    return value;
+                }
+
+                inline double max_f64(double const* x, std::size_t n) noexcept
+                {
+                    double value = -std::numeric_limits<double>::infinity();
+
+                    for (std::size_t i = 0; i < n; ++i)
+                    {
+                        value = x[i] > value ? x[i] : value;
+                    }
+
+                    return value;
+                }
+
+                inline void fma_f64(double* out, double const* a, double const* b, double const* c, std::size_t n) noexcept
+                {
+                    for (std::size_t i = 0; i < n; ++i)
+                    {
+                        out[i] = a[i] * b[i] + c[i];
+                    }
+                }
+
+                inline void gather_f64(double* out, double const* src, int32_t const* idx, std::size_t n) noexcept
+                {
+                    for (std::size_t i = 0; i < n; ++i)
+                    {
+                        out[i] = src[idx[i]];
+                    }
+                }
+
+                inline std::size_t filter_gt_f64(int32_t* out, double const* x, std::size_t n, double threshold) noexcept
+                {
+                    std::size_t count = 0;
+
+                    for (std::size_t i = 0; i < n; ++i)
+                    {
+                        out[count] = static_cast<int32_t>(i);
+                        count += x[i] > threshold ? 1 : 0;
+                    }
+
+                    return count;
+                }
+
+                inline void prefix_sum_f64(double* out, double const* x, std::size_t n, double carry) noexcept
+                {
+                    for (std::size_t i = 0; i < n; ++i)
+                    {
+                        carry += x[i];
+                        out[i] = carry;
+                    }
+                }
+            }
+
+            #if defined(TW_PRIV_KERNELS_X64)
+
+            /// Return true if cpu and os support AVX2 and FMA, detected once
+            inline bool has_avx2() noexcept
+            {
+                static bool const value = [] {
+                    #if defined(_MSC_VER) && !defined(__clang__)
+                    int info[4];
+
+                    __cpuid(info, 0);
+
+                    if (info[0] < 7)
+                    {
+                        return false;
+                    }
+
+                    __cpuid(info, 1);
+
+                    bool const has_fma     = (info[2] & (1 << 12)) != 0;
+                    bool const has_osxsave = (info[2] & (1 << 27)) != 0;
+                    bool const has_avx     = (info[2] & (1 << 28)) != 0;
+
+                    if (!has_fma || !has_osxsave || !has_avx || (_xgetbv(0) & 6) != 6)
+                    {
+                        return false;
+                    }
+
+                    __cpuidex(info, 7, 0);
+
+                    return (info[1] & (1 << 5)) != 0;
+                    #else
+                    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+                    #endif
+                }();
+
+                return value;
+            }
+
+            /// SSE2 kernels, baseline on x86-64
+            namespace sse2
+            {
+                inline double hsum(__m128d v) noexcept
+                {
+                    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+                }
+
+                inline double sum_f64(double const* x, std::size_t n) noexcept
+                {
+                    __m128d acc0 = _mm_setzero_pd();
+                    __m128d acc1 = _mm_setzero_pd();
+                    std::size_t i = 0;
+
+                    for (; i + 4 <= n; i += 4)
+                    {
+                        acc0 = _mm_add_pd(acc0, _mm_loadu_pd(x + i));
+                        acc1 = _mm_add_pd(acc1, _mm_loadu_pd(x + i + 2));
+                    }
+
+                    return hsum(_mm_add_pd(acc0, acc1)) + scalar::sum_f64(x + i, n - i);
+                }
+
+                inline double dot_f64(double const* x, double const* y, std::size_t n) noexcept
+                {
+                    __m128d acc0 = _mm_setzero_pd();
+                    __m128d acc1 = _mm_setzero_pd();
+                    std::size_t i = 0;
+
+                    for (; i + 4 <= n; i += 4)
+                    {
+                        acc0 = _mm_add_pd(acc0, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+                        acc1 = _mm_add_pd(acc1, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+                    }
+
+                    return hsum(_mm_add_pd(acc0, acc1)) + scalar::dot_f64(x + i, y + i, n - i);
+                }
+
+                inline double min_f64(double const* x, std::size_t n) noexcept
+                {
+                    __m128d acc = _mm_set1_pd(std::numeric_limits<double>::infinity());
+                    std::size_t i = 0;
+
+                    for (; i + 2 <= n; i += 2)
+                    {
+                        acc = _mm_min_pd(_mm_loadu_pd(x + i), acc);
+                    }
+
+                    acc = _mm_min_sd(acc, _mm_unpackhi_pd(acc, acc));
+
+                    return std::min(_mm_cvtsd_f64(acc), scalar::min_f64(x + i, n - i));
+                }
+
+                inline double max_f64(double const* x, std::size_t n) noexcept
+                {
+                    __m128d acc = _mm_set1_pd(-std::numeric_limits<double>::infinity());
+                    std::size_t i = 0;
+
+                    for (; i + 2 <= n; i += 2)
+                    {
+                        acc = _mm_max_pd(_mm_loadu_pd(x + i), acc);
+                    }
+
+                    acc = _mm_max_sd(acc, _mm_unpackhi_pd(acc, acc));
+
+                    return std::max(_mm_cvtsd_f64(acc), scalar::max_f64(x + i, n - i));
+                }
+
+                inline void fma_f64(double* out, double const* a, double const* b, double const* c, std::size_t n) noexcept
+                {
+                    std::size_t i = 0;
+
+                    for (; i + 2 <= n; i += 2)
+                    {
+                        _mm_storeu_pd(out + i, _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)), _mm_loadu_pd(c + i)));
+                    }
+
+                    scalar::fma_f64(out + i, a + i, b + i, c + i, n - i);
+                }
+            }
+
+            /// AVX2 + FMA kernels, selected at runtime
+            namespace avx2
+            {
+                TW_PRIV_TARGET_AVX2 inline double hsum(__m256d v) noexcept
+                {
+                    return sse2::hsum(_mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1)));
+                }
+
+                TW_PRIV_TARGET_AVX2 inline double sum_f64(double const* x, std::size_t n) noexcept
+                {
+                    __m256d acc0 = _mm256_setzero_pd();
+                    __m256d acc1 = _mm256_setzero_pd();
+                    std::size_t i = 0;
+
+                    for (; i + 8 <= n; i += 8)
+                    {
+                        acc0 = _mm256_add_pd(acc0, _mm256_loadu_pd(x + i));
+                        acc1 = _mm256_add_pd(acc1, _mm256_loadu_pd(x + i + 4));
+                    }
+
+                    return hsum(_mm256_add_pd(acc0, acc1)) + scalar::sum_f64(x + i, n - i);
+                }
+
+                TW_PRIV_TARGET_AVX2 inline double dot_f64(double const* x, double const* y, std::size_t n) noexcept
+                {
+                    __m256d acc0 = _mm256_setzero_pd();
+                    __m256d acc1 = _mm256_setzero_pd();
+                    std::size_t i = 0;
+
+                    for (; i + 8 <= n; i += 8)
+                    {
+                        acc0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), acc0);
+                        acc1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), acc1);
+                    }
+
+                    return hsum(_mm256_add_pd(acc0, acc1)) + scalar::dot_f64(x + i, y + i, n - i);
+                }
+
+                TW_PRIV_TARGET_AVX2 inline double min_f64(double const* x, std::size_t n) noexcept
+                {
+                    __m256d acc = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+                    std::size_t i = 0;
+
+                    for (; i + 4 <= n; i += 4)
+                    {
+                        acc = _mm256_min_pd(_mm256_loadu_pd(x + i), acc);
+                    }
+
+                    __m128d half = _mm_min_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+                    half = _mm_min_sd(half, _mm_unpackhi_pd(half, half));
+
+                    return std::min(_mm_cvtsd_f64(half), scalar::min_f64(x + i, n - i));
+                }
+
+                TW_PRIV_TARGET_AVX2 inline double max_f64(double const* x, std::size_t n) noexcept
+                {
+                    __m256d acc = _mm256_set1_pd(-std::numeric_limits<double>::infinity());
+                    std::size_t i = 0;
+
+                    for (; i + 4 <= n; i += 4)
+                    {
+                        acc = _mm256_max_pd(_mm256_loadu_pd(x + i), acc);
+                    }
+
+                    __m128d half = _mm_max_pd(_mm256_castpd256_pd128(acc), _mm256_extractf128_pd(acc, 1));
+                    half = _mm_max_sd(half, _mm_unpackhi_pd(half, half));
+
+                    return std::max(_mm_cvtsd_f64(half), scalar::max_f64(x + i, n - i));
+                }
+
+                TW_PRIV_TARGET_AVX2 inline void fma_f64(double* out, double const* a, double const* b, double const* c, std::size_t n) noexcept
+                {
+                    std::size_t i = 0;
+
+                    for (; i + 4 <= n; i += 4)
+                    {
+                        _mm256_storeu_pd(out + i, _mm256_fmadd_pd(_mm256_loadu_pd(a + i), _mm256_loadu_pd(b + i), _mm256_loadu_pd(c + i)));
+                    }
+
+                    // tail stays fused too, so whole array is rounded same way
+                    for (; i < n; ++i)
+                    {
+                        out[i] = std::fma(a[i], b[i], c[i]);
+                    }
+                }
+
+                TW_PRIV_TARGET_AVX2 inline void gather_f64(double* out, double const* src, int32_t const* idx, std::size_t n) noexcept
+                {
+                    // masked form with explicit zero source, unmasked intrinsic leaves its pass-through operand uninitialized
+                    auto const all_ones = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+                    std::size_t i = 0;
+
+                    for (; i + 4 <= n; i += 4)
+                    {
+                        auto const indices = _mm_loadu_si128(reinterpret_cast<__m128i const*>(idx + i));
+
+                        _mm256_storeu_pd(out + i, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), src, indices, all_ones, 8));
+                    }
+
+                    scalar::gather_f64(out + i, src, idx + i, n - i);
+                }
+
+                TW_PRIV_TARGET_AVX2 inline std::size_t filter_gt_f64(int32_t* out, double const* x, std::size_t n, double threshold) noexcept
+                {
+                    auto const limit = _mm256_set1_pd(threshold);
+                    std::size_t count = 0;
+                    std::size_t i = 0;
+
+                    for (; i + 4 <= n; i += 4)
+                    {
+                        auto const mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(x + i), limit, _CMP_GT_OQ)));
+
+                        if (mask != 0)
+                        {
+                            for (unsigned lane = 0; lane < 4; ++lane)
+                            {
+                                out[count] = static_cast<int32_t>(i + lane);
+                                count += (mask >> lane) & 1;
+                            }
+                        }
+                    }
+
+                    for (; i < n; ++i)
+                    {
+                        out[count] = static_cast<int32_t>(i);
+                        count += x[i] > threshold ? 1 : 0;
+                    }
+
+                    return count;
+                }
+
+                TW_PRIV_TARGET_AVX2 inline void prefix_sum_f64(double* out, double const* x, std::size_t n) noexcept
+                {
+                    auto const zero = _mm256_setzero_pd();
+                    auto carry = zero;
+                    std::size_t i = 0;
+
+                    for (; i + 4 <= n; i += 4)
+                    {
+                        auto v = _mm256_loadu_pd(x + i);
+                        v = _mm256_add_pd(v, _mm256_blend_pd(_mm256_permute4x64_pd(v, _MM_SHUFFLE(2, 1, 0, 0)), zero, 0x1));
+                        v = _mm256_add_pd(v, _mm256_blend_pd(_mm256_permute4x64_pd(v, _MM_SHUFFLE(1, 0, 0, 0)), zero, 0x3));
+                        v = _mm256_add_pd(v, carry);
+
+                        _mm256_storeu_pd(out + i, v);
+
+                        carry = _mm256_permute4x64_pd(v, _MM_SHUFFLE(3, 3, 3, 3));
+                    }
+
+                    scalar::prefix_sum_f64(out + i, x + i, n - i, _mm256_cvtsd_f64(carry));
+                }
+            }
+
+            #endif
+        }
+    }
+
+    /// Array kernels callable from scripts after TccWrapper::register_kernels, vectorized with AVX2/SSE2 when available
+    /// Vectorized reductions may sum in different order than scalar loop, so last bits of result can differ
+    /// fma_f64 is fused (single rounding) on AVX2 hosts and separate multiply and add elsewhere, so its last bit can differ between hosts
+    namespace kernels
+    {
+        /// Return x[0] + ... + x[n - 1]
+        inline double sum_f64(double const* x, std::size_t n) noexcept
+        {
+            #if defined(TW_PRIV_KERNELS_X64)
+            return priv::kernels::has_avx2() ? priv::kernels::avx2::sum_f64(x, n) : priv::kernels::sse2::sum_f64(x, n);
+            #else
+            return priv::kernels::scalar::sum_f64(x, n);
+            #endif
+        }
+
+        /// Return x[0] * y[0] + ... + x[n - 1] * y[n - 1]
+        inline double dot_f64(double const* x, double const* y, std::size_t n) noexcept
+        {
+            #if defined(TW_PRIV_KERNELS_X64)
+            return priv::kernels::has_avx2() ? priv::kernels::avx2::dot_f64(x, y, n) : priv::kernels::sse2::dot_f64(x, y, n);
+            #else
+            return priv::kernels::scalar::dot_f64(x, y, n);
+            #endif
+        }
+
+        /// Return smallest element or +infinity if n is 0
+        inline double min_f64(double const* x, std::size_t n) noexcept
+        {
+            #if defined(TW_PRIV_KERNELS_X64)
+            return priv::kernels::has_avx2() ? priv::kernels::avx2::min_f64(x, n) : priv::kernels::sse2::min_f64(x, n);
+            #else
+            return priv::kernels::scalar::min_f64(x, n);
+            #endif
+        }
+
+        /// Return largest element or -infinity if n is 0
+        inline double max_f64(double const* x, std::size_t n) noexcept
+        {
+            #if defined(TW_PRIV_KERNELS_X64)
+            return priv::kernels::has_avx2() ? priv::kernels::avx2::max_f64(x, n) : priv::kernels::sse2::max_f64(x, n);
+            #else
+            return priv::kernels::scalar::max_f64(x, n);
+            #endif
+        }
+
+        /// Compute out[i] = a[i] * b[i] + c[i], out may alias inputs, rounded once on AVX2 hosts and twice elsewhere
+        inline void fma_f64(double* out, double const* a, double const* b, double const* c, std::size_t n) noexcept
+        {
+            #if defined(TW_PRIV_KERNELS_X64)
+            priv::kernels::has_avx2() ? priv::kernels::avx2::fma_f64(out, a, b, c, n) : priv::kernels::sse2::fma_f64(out, a, b, c, n);
+            #else
+            priv::kernels::scalar::fma_f64(out, a, b, c, n);
+            #endif
+        }
+
+        /// Compute out[i] = src[idx[i]]
+        inline void gather_f64(double* out, double const* src, int32_t const* idx, std::size_t n) noexcept
+        {
+            #if defined(TW_PRIV_KERNELS_X64)
+            priv::kernels::has_avx2() ? priv::kernels::avx2::gather_f64(out, src, idx, n) : priv::kernels::scalar::gather_f64(out, src, idx, n);
+            #else
+            priv::kernels::scalar::gather_f64(out, src, idx, n);
+            #endif
+        }
+
+        /// Write indices i for which x[i] > threshold to out (capacity of n required), return their count
+        inline std::size_t filter_gt_f64(int32_t* out, double const* x, std::size_t n, double threshold) noexcept
+        {
+            #if defined(TW_PRIV_KERNELS_X64)
+            return priv::kernels::has_avx2() ? priv::kernels::avx2::filter_gt_f64(out, x, n, threshold) : priv::kernels::scalar::filter_gt_f64(out, x, n, threshold);
+            #else
+            return priv::kernels::scalar::filter_gt_f64(out, x, n, threshold);
+            #endif
+        }
+
+        /// Compute inclusive prefix sum out[i] = x[0] + ... + x[i], out may alias x
+        inline void prefix_sum_f64(double* out, double const* x, std::size_t n) noexcept
+        {
+            #if defined(TW_PRIV_KERNELS_X64)
+            priv::kernels::has_avx2() ? priv::kernels::avx2::prefix_sum_f64(out, x, n) : priv::kernels::scalar::prefix_sum_f64(out, x, n, 0.0);
+            #else
+            priv::kernels::scalar::prefix_sum_f64(out, x, n, 0.0);
+            #endif
+        }
+
+        /// C prototypes of kernels as seen by scripts
+        inline constexpr char const* prelude =
+            "double tw_sum_f64(double const* x, __SIZE_TYPE__ n);\n"
+            "double tw_dot_f64(double const* x, double const* y, __SIZE_TYPE__ n);\n"
+            "double tw_min_f64(double const* x, __SIZE_TYPE__ n);\n"
+            "double tw_max_f64(double const* x, __SIZE_TYPE__ n);\n"
+            "void tw_fma_f64(double* out, double const* a, double const* b, double const* c, __SIZE_TYPE__ n);\n"
+            "void tw_gather_f64(double* out, double const* src, int const* idx, __SIZE_TYPE__ n);\n"
+            "__SIZE_TYPE__ tw_filter_gt_f64(int* out, double const* x, __SIZE_TYPE__ n, double threshold);\n"
+            "void tw_prefix_sum_f64(double* out, double const* x, __SIZE_TYPE__ n);\n";
+    }
+
+    #endif
+
+    #if defined(TW_USE_TRACER)
+
+    /// Process-wide recorder of begin/end events of wrapper calls, written as Chrome trace JSON (chrome://tracing, Perfetto)
+    /// Each thread appends to own fixed-size buffer without locking, events past its capacity are dropped and counted
+    class Tracer
+    {
+    public:
+
+        /// Return process-wide tracer
+        static Tracer& get() noexcept
+        {
+            static Tracer tracer;
+
+            return tracer;
+        }
+
+        /// Deleted copy-ctor
+        Tracer(Tracer const&) = delete;
+
+        /// Deleted copy-assign-op
+        Tracer& operator=(Tracer const&) = delete;
+
+        /// Start recording events
+        void enable() noexcept
+        {
+            m_is_enabled.store(true, std::memory_order_relaxed);
+        }
+
+        /// Stop recording events, calls already in progress still record their end events
+        void disable() noexcept
+        {
+            m_is_enabled.store(false, std::memory_order_relaxed);
+        }
+
+        /// Check if events are recorded
+        bool is_enabled() const noexcept
+        {
+            return m_is_enabled.load(std::memory_order_relaxed);
+        }
+
+        /// Record event of given phase ('B' or 'E'), name must be string literal, return false if event was dropped
+        /// Each recorded 'B' keeps slot for its 'E', so spans stay balanced when buffer fills up (record 'E' only for recorded 'B')
+        bool record(char const* name, char phase, void const* state) noexcept
+        {
+            auto const buffer = get_thread_buffer();
+
+            if (buffer == nullptr)
+            {
+                return false;
+            }
+
+            auto const size = buffer->size.load(std::memory_order_relaxed);
+            auto const is_begin = phase == 'B';
+            auto const is_end = phase == 'E' && buffer->open_count > 0;
+            auto const reserved = buffer->open_count + (is_begin ? 1u : 0u) - (is_end ? 1u : 0u);
+
+            if (size + 1 + reserved > s_buffer_capacity)
+            {
+                buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+
+                return false;
+            }
+
+            auto const now = std::chrono::steady_clock::now() - m_epoch;
+
+            buffer->events[size] = { name, state, std::chrono::duration_cast<std::chrono::nanoseconds>(now).count(), buffer->thread_id, phase };
+            buffer->size.store(size + 1, std::memory_order_release);
+            buffer->open_count = reserved;
+
+            return true;
+        }
+
+        /// Discard recorded events (buffers of exited threads are kept for reuse), call only when no traced calls are in progress
+        void clear() noexcept
+        {
+            std::lock_guard<std::mutex> const lock{ m_buffers_mutex };
+
+            for (auto const& buffer : m_buffers)
+            {
+                buffer->size.store(0, std::memory_order_relaxed);
+                buffer->dropped.store(0, std::memory_order_relaxed);
+            }
+        }
+
+        /// Return number of events dropped because thread buffers were full
+        std::size_t get_dropped_count() const
+        {
+            std::lock_guard<std::mutex> const lock{ m_buffers_mutex };
+
+            std::size_t count = 0;
+
+            for (auto const& buffer : m_buffers)
+            {
+                count += buffer->dropped.load(std::memory_order_relaxed);
+            }
+
+            return count;
+        }
+
+        /// Write recorded events as Chrome trace JSON
+        void write_chrome_trace(std::ostream& out) const
+        {
+            std::lock_guard<std::mutex> const lock{ m_buffers_mutex };
+
+            out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+            auto is_first = true;
+
+            for (auto const& buffer : m_buffers)
+            {
+                auto const size = buffer->size.load(std::memory_order_acquire);
+
+                for (std::size_t i = 0; i < size; ++i)
+                {
+                    auto const& event = buffer->events[i];
+
+                    char line[256];
+                    std::snprintf(line, sizeof(line),
+                        "%s\n{\"name\":\"%s\",\"cat\":\"tcc\",\"ph\":\"%c\",\"ts\":%lld.%03lld,\"pid\":1,\"tid\":%zu,\"args\":{\"state\":\"%p\"}}",
+                        is_first ? "" : ",", event.name, event.phase,
+                        static_cast<long long>(event.timestamp / 1000), static_cast<long long>(event.timestamp % 1000),
+                        std::size_t{ event.thread_id }, event.state
+                    );
+
+                    out << line;
+                    is_first = false;
+                }
+            }
+
+            out << "\n]}\n";
+        }
+
+        /// Save recorded events as Chrome trace JSON file, return true on success
+        bool save_chrome_trace(char const* filename) const
+        {
+            std::ofstream file{ filename };
+
+            write_chrome_trace(file);
+
+            return static_cast<bool>(file);
+        }
+
+    private:
+
+        /// PRIV: Single recorded event
+        struct Event
+        {
+            char const* name;
+            void const* state;
+            int64_t timestamp;
+            uint32_t thread_id;
+            char phase;
+        };
+
+        /// PRIV: Events of single thread, written only by that thread, reused by next new thread (with new thread id) after it exits
+        struct Buffer
+        {
+            uint32_t thread_id;
+            std::unique_ptr<Event[]> events;
+            std::atomic<std::size_t> size;
+            std::atomic<std::size_t> dropped;
+            std::size_t open_count;
+            bool is_free;
+        };
+
+        /// PRIV: Holder of calling thread's buffer, returns it for reuse on thread exit so thread churn does not grow memory
+        struct ThreadSlot
+        {
+            Buffer* buffer = nullptr;
+
+            /// Mark buffer as free, its events stay recorded until clear
+            ~ThreadSlot() noexcept
+            {
+                if (buffer != nullptr)
+                {
+                    std::lock_guard<std::mutex> const lock{ Tracer::get().m_buffers_mutex };
+
+                    buffer->is_free = true;
+                }
+            }
+        };
+
+        /// PRIV: Maximum number of events recorded per thread
+        static constexpr std::size_t s_buffer_capacity = 1 << 16;
+
+        /// PRIV: Internal private ctor
+        Tracer() noexcept
+            : m_is_enabled { false }
+            , m_epoch { std::chrono::steady_clock::now() }
+        {
+
+        }
+
+        /// PRIV: Return buffer of calling thread, take free one or register new one on first use, nullptr if allocation failed
+        Buffer* get_thread_buffer() noexcept
+        {
+            thread_local ThreadSlot t_slot;
+
+            if (t_slot.buffer == nullptr)
+            {
+                try
+                {
+                    std::lock_guard<std::mutex> const lock{ m_buffers_mutex };
+
+                    for (auto const& buffer : m_buffers)
+                    {
+                        if (buffer->is_free)
+                        {
+                            buffer->is_free = false;
+                            buffer->thread_id = ++m_threads_count;
+                            buffer->open_count = 0;
+                            t_slot.buffer = buffer.get();
+
+                            return t_slot.buffer;
+                        }
+                    }
+
+                    auto buffer = std::make_unique<Buffer>();
+                    buffer->thread_id = ++m_threads_count;
+                    buffer->events = std::make_unique<Event[]>(s_buffer_capacity);
+                    buffer->size = 0;
+                    buffer->dropped = 0;
+                    buffer->open_count = 0;
+                    buffer->is_free = false;
+
+                    m_buffers.push_back(std::move(buffer));
+                    t_slot.buffer = m_buffers.back().get();
+                }
+                catch (...)
+                {
+                    return nullptr;
+                }
+            }
+
+            return t_slot.buffer;
+        }
+
+        std::atomic<bool> m_is_enabled;
+        std::chrono::steady_clock::time_point m_epoch;
+        mutable std::mutex m_buffers_mutex;
+        std::vector<std::unique_ptr<Buffer>> m_buffers;
+        uint32_t m_threads_count = 0;
+    };
+
+    #endif
+
+    namespace priv
+    {
+        /// Scoped begin/end trace event of wrapper call, no-op without TW_USE_TRACER
+        struct TraceScope
+        {
+            #if defined(TW_USE_TRACER)
+
+            /// Record begin event if tracer is enabled and buffer has room, state is read again for end event
+            TraceScope(char const* name, TCCState* const& state) noexcept
+                : m_name { name }
+                , m_state { state }
+                , m_is_recording { Tracer::get().is_enabled() && Tracer::get().record(name, 'B', state) }
+            {
+            }
+
+            /// Record end event if begin event was recorded
+            ~TraceScope() noexcept
+            {
+                if (m_is_recording)
+                {
+                    Tracer::get().record(m_name, 'E', m_state);
+                }
+            }
+
+            /// Deleted copy-ctor
+            TraceScope(TraceScope const&) = delete;
+
+            /// Deleted copy-assign-op
+            TraceScope& operator=(TraceScope const&) = delete;
+
+            char const* m_name;
+            TCCState* const& m_state;
+            bool m_is_recording;
+
+            #else
+
+            /// Do nothing
+            TraceScope(char const*, TCCState* const&) noexcept
+            {
+
+            }
+
+            #endif
+        };
+    }
+
+    #if defined(TW_USE_PROFILER)
+
+    /// Process-wide sampling profiler attributing CPU time to functions of compiled code, Linux only
+    /// SIGPROF is raised by CPU-time timer of each thread (running when sampling starts), signal handler stores sampled PC (and caller of compiled function) in lock-free ring
+    /// Samples are mapped to functions of live wrappers when profile is requested, PCs outside compiled code are counted as <host>
+    /// Compiled functions are known by names resolved with get_symbol (or invoke), code of unresolved functions is attributed
+    /// to closest preceding resolved function, so resolve helpers with has_symbol to profile them separately
+    class Profiler
+    {
+    public:
+
+        /// Samples of single function
+        struct FlatEntry
+        {
+            std::string name;
+            std::size_t samples;
+        };
+
+        /// Samples of function called directly from another function
+        struct CallEntry
+        {
+            std::string caller;
+            std::string callee;
+            std::size_t samples;
+        };
+
+        /// Return process-wide profiler
+        static Profiler& get() noexcept
+        {
+            static Profiler profiler;
+
+            return profiler;
+        }
+
+        /// Deleted copy-ctor
+        Profiler(Profiler const&) = delete;
+
+        /// Deleted copy-assign-op
+        Profiler& operator=(Profiler const&) = delete;
+
+        /// Start sampling every interval of CPU time of each thread running now (threads started later are not sampled
+        /// until restart), return true on success
+        bool start(std::chrono::microseconds interval = std::chrono::milliseconds{ 1 }) noexcept
+        {
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            if (m_is_running.load(std::memory_order_relaxed))
+            {
+                return false;
+            }
+
+            if (!m_has_handler)
+            {
+                struct sigaction action = {};
+                action.sa_sigaction = &on_signal;
+                action.sa_flags = SA_SIGINFO | SA_RESTART;
+                sigemptyset(&action.sa_mask);
+
+                // previous handler (of another profiler) is kept and chained from on_signal
+                if (sigaction(SIGPROF, &action, &m_previous_action) != 0)
+                {
+                    return false;
+                }
+
+                m_has_handler = true;
+            }
+
+            auto const seconds = std::chrono::duration_cast<std::chrono::duration<time_t>>(interval);
+            auto const nanoseconds = std::chrono::duration_cast<std::chrono::duration<long, std::nano>>(interval - seconds);
+
+            struct itimerspec spec = {};
+            spec.it_interval.tv_sec = seconds.count();
+            spec.it_interval.tv_nsec = nanoseconds.count();
+            spec.it_value = spec.it_interval;
+
+            m_is_running.store(true, std::memory_order_release);
+
+            // Timer per thread, process CPU-time timer would deliver signal to any thread (mostly main one on older kernels)
+            auto const tasks = opendir("/proc/self/task");
+
+            if (tasks != nullptr)
+            {
+                while (auto const entry = readdir(tasks))
+                {
+                    // "." and ".." are parsed as 0
+                    auto const thread_id = static_cast<pid_t>(std::strtol(entry->d_name, nullptr, 10));
+
+                    if (thread_id > 0)
+                    {
+                        add_thread_timer(thread_id, spec);
+                    }
+                }
+
+                closedir(tasks);
+            }
+
+            if (m_timers.empty())
+            {
+                m_is_running.store(false, std::memory_order_release);
+
+                return false;
+            }
+
+            return true;
+        }
+
+        /// Stop sampling, already recorded samples are kept
+        void stop() noexcept
+        {
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            if (m_is_running.exchange(false, std::memory_order_acq_rel))
+            {
+                // Handler stays installed, so signals still pending are ignored instead of terminating process
+                for (auto const timer : m_timers)
+                {
+                    timer_delete(timer);
+                }
+
+                m_timers.clear();
+            }
+        }
+
+        /// Check if profiler is sampling
+        bool is_running() const noexcept
+        {
+            return m_is_running.load(std::memory_order_relaxed);
+        }
+
+        /// Discard recorded samples
+        void clear() noexcept
+        {
+            m_read_index.store(m_write_index.load(std::memory_order_acquire), std::memory_order_release);
+        }
+
+        /// Return number of samples in ring (older samples are overwritten)
+        std::size_t get_samples_count() const noexcept
+        {
+            return std::min(m_write_index.load(std::memory_order_acquire) - m_read_index.load(std::memory_order_acquire), s_ring_capacity);
+        }
+
+        /// Return samples per function, sorted from most sampled
+        std::vector<FlatEntry> get_flat_profile() const
+        {
+            std::map<std::string, std::size_t> counts;
+
+            for_each_sample([&counts](std::string const& callee, std::string const*) {
+                ++counts[callee];
+            });
+
+            std::vector<FlatEntry> entries;
+
+            for (auto& [name, samples] : counts)
+            {
+                entries.push_back({ name, samples });
+            }
+
+            std::sort(entries.begin(), entries.end(), [](auto const& lhs, auto const& rhs) { return lhs.samples > rhs.samples; });
+
+            return entries;
+        }
+
+        /// Return samples per caller-callee pair of compiled functions, sorted from most sampled
+        std::vector<CallEntry> get_call_profile() const
+        {
+            std::map<std::pair<std::string, std::string>, std::size_t> counts;
+
+            for_each_sample([&counts](std::string const& callee, std::string const* caller) {
+                if (caller != nullptr)
+                {
+                    ++counts[{ *caller, callee }];
+                }
+            });
+
+            std::vector<CallEntry> entries;
+
+            for (auto& [names, samples] : counts)
+            {
+                entries.push_back({ names.first, names.second, samples });
+            }
+
+            std::sort(entries.begin(), entries.end(), [](auto const& lhs, auto const& rhs) { return lhs.samples > rhs.samples; });
+
+            return entries;
+        }
+
+        /// Write flat and caller-callee profiles as text
+        void write_report(std::ostream& out) const
+        {
+            auto const flat = get_flat_profile();
+
+            std::size_t total = 0;
+
+            for (auto const& entry : flat)
+            {
+                total += entry.samples;
+            }
+
+            out << "samples  percent  function\n";
+
+            for (auto const& entry : flat)
+            {
+                out << entry.samples << "  " << (100.0 * static_cast<double>(entry.samples) / static_cast<double>(total)) << "%  " << entry.name << '\n';
+            }
+
+            out << "\nsamples  caller -> callee\n";
+
+            for (auto const& entry : get_call_profile())
+            {
+                out << entry.samples << "  " << entry.caller << " -> " << entry.callee << '\n';
+            }
+        }
+
+        /// Register memory of compiled code, called by TccWrapper
+        void add_image(void const* image, std::size_t size)
+        {
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            auto const begin = reinterpret_cast<uintptr_t>(image);
+
+            m_images[begin] = Image{ begin + size, {} };
+
+            for (auto& range : m_ranges)
+            {
+                if (range.begin.load(std::memory_order_relaxed) == 0)
+                {
+                    range.end.store(begin + size, std::memory_order_relaxed);
+                    range.begin.store(begin, std::memory_order_release);
+
+                    break;
+                }
+            }
+        }
+
+        /// Unregister memory of compiled code, called by TccWrapper
+        void remove_image(void const* image)
+        {
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            auto const begin = reinterpret_cast<uintptr_t>(image);
+
+            m_images.erase(begin);
+
+            for (auto& range : m_ranges)
+            {
+                if (range.begin.load(std::memory_order_relaxed) == begin)
+                {
+                    range.begin.store(0, std::memory_order_release);
+                }
+            }
+        }
+
+        /// Register name of function in compiled code, called by TccWrapper
+        void add_symbol(void const* image, char const* name, void const* address)
+        {
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            auto const it = m_images.find(reinterpret_cast<uintptr_t>(image));
+            auto const pc = reinterpret_cast<uintptr_t>(address);
+
+            if (it != m_images.end() && pc >= it->first && pc < it->second.end)
+            {
+                it->second.symbols.emplace(pc, name);
+            }
+        }
+
+    private:
+
+        /// PRIV: Sampled program counter with return address (0 if unknown), seq is index + 1 once written
+        struct Sample
+        {
+            std::atomic<std::size_t> seq;
+            std::atomic<uintptr_t> pc;
+            std::atomic<uintptr_t> caller;
+        };
+
+        /// PRIV: Address range of compiled code readable from signal handler, free slot has begin 0
+        struct Range
+        {
+            std::atomic<uintptr_t> begin;
+            std::atomic<uintptr_t> end;
+        };
+
+        /// PRIV: Compiled code of single wrapper with names of resolved functions by address
+        struct Image
+        {
+            uintptr_t end;
+            std::map<uintptr_t, std::string> symbols;
+        };
+
+        /// PRIV: Maximum number of samples kept
+        static constexpr std::size_t s_ring_capacity = 1 << 16;
+
+        /// PRIV: Maximum number of images whose callers are recorded
+        static constexpr std::size_t s_ranges_capacity = 256;
+
+        /// PRIV: Maximum distance of frame pointer from stack pointer trusted by signal handler
+        static constexpr uintptr_t s_max_frame_distance = 64 * 1024;
+
+        /// PRIV: Internal private ctor
+        Profiler() noexcept
+            : m_samples { std::make_unique<Sample[]>(s_ring_capacity) }
+            , m_write_index { 0 }
+            , m_read_index { 0 }
+            , m_is_running { false }
+            , m_has_handler { false }
+        {
+
+        }
+
+        /// PRIV: Create timer sampling CPU time of given thread, thread which exited meanwhile is skipped
+        void add_thread_timer(pid_t thread_id, struct itimerspec const& spec) noexcept
+        {
+            // Encoding of thread CPU-time clock used by pthread_getcpuclockid, valid for any thread of process
+            auto const clock = static_cast<clockid_t>((~static_cast<unsigned>(thread_id) << 3) | 6u);
+
+            struct sigevent event = {};
+            event.sigev_notify = SIGEV_THREAD_ID;
+            event.sigev_signo = SIGPROF;
+
+            #if defined(sigev_notify_thread_id)
+            event.sigev_notify_thread_id = thread_id;
+            #else
+            event._sigev_un._tid = thread_id;
+            #endif
+
+            timer_t timer;
+
+            if (timer_create(clock, &event, &timer) != 0)
+            {
+                return;
+            }
+
+            if (timer_settime(timer, 0, &spec, nullptr) != 0)
+            {
+                timer_delete(timer);
+
+                return;
+            }
+
+            m_timers.push_back(timer);
+        }
+
+        /// PRIV: Check if address lies in compiled code, async-signal-safe
+        bool is_in_image(uintptr_t pc) const noexcept
+        {
+            for (auto const& range : m_ranges)
+            {
+                auto const begin = range.begin.load(std::memory_order_acquire);
+
+                if (begin != 0 && pc >= begin && pc < range.end.load(std::memory_order_relaxed))
+                {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        /// PRIV: SIGPROF handler, reads registers from interrupted context and appends sample
+        static void on_signal(int signo, siginfo_t* info, void* context) noexcept
+        {
+            auto& profiler = get();
+
+            chain_previous_handler(profiler.m_previous_action, signo, info, context);
+
+            if (!profiler.m_is_running.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+
+            auto const& registers = static_cast<ucontext_t*>(context)->uc_mcontext;
+
+            uintptr_t pc = 0;
+            uintptr_t fp = 0;
+            uintptr_t sp = 0;
+
+            #if defined(__x86_64__)
+            pc = static_cast<uintptr_t>(registers.gregs[REG_RIP]);
+            fp = static_cast<uintptr_t>(registers.gregs[REG_RBP]);
+            sp = static_cast<uintptr_t>(registers.gregs[REG_RSP]);
+            #elif defined(__i386__)
+            pc = static_cast<uintptr_t>(registers.gregs[REG_EIP]);
+            fp = static_cast<uintptr_t>(registers.gregs[REG_EBP]);
+            sp = static_cast<uintptr_t>(registers.gregs[REG_ESP]);
+            #elif defined(__aarch64__)
+            pc = static_cast<uintptr_t>(registers.pc);
+            fp = static_cast<uintptr_t>(registers.regs[29]);
+            sp = static_cast<uintptr_t>(registers.sp);
+            #endif
+
+            uintptr_t caller = 0;
+
+            // tcc always keeps frame pointer, return address lies right above saved one
+            if (profiler.is_in_image(pc) && fp >= sp && fp - sp < s_max_frame_distance && fp % sizeof(uintptr_t) == 0)
+            {
+                std::memcpy(&caller, reinterpret_cast<void const*>(fp + sizeof(uintptr_t)), sizeof(caller));
+            }
+
+            auto const index = profiler.m_write_index.fetch_add(1, std::memory_order_relaxed);
+            auto& sample = profiler.m_samples[index % s_ring_capacity];
+
+            sample.seq.store(0, std::memory_order_relaxed);
+            std::atomic_signal_fence(std::memory_order_release);
+            sample.pc.store(pc, std::memory_order_relaxed);
+            sample.caller.store(caller, std::memory_order_relaxed);
+            sample.seq.store(index + 1, std::memory_order_release);
+        }
+
+        /// PRIV: Forward signal to handler installed before profiler, if there was any
+        static void chain_previous_handler(struct sigaction const& previous, int signo, siginfo_t* info, void* context) noexcept
+        {
+            if ((previous.sa_flags & SA_SIGINFO) != 0)
+            {
+                if (previous.sa_sigaction != nullptr)
+                {
+                    previous.sa_sigaction(signo, info, context);
+                }
+            }
+            else if (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN)
+            {
+                previous.sa_handler(signo);
+            }
+        }
+
+        /// PRIV: Return name of function containing address, nullptr if address is outside compiled code
+        std::string const* find_function(uintptr_t pc) const
+        {
+            static std::string const unresolved = "<unresolved>";
+
+            auto it = m_images.upper_bound(pc);
+
+            if (it == m_images.begin())
+            {
+                return nullptr;
+            }
+
+            --it;
+
+            if (pc >= it->second.end)
+            {
+                return nullptr;
+            }
+
+            auto symbol = it->second.symbols.upper_bound(pc);
+
+            return symbol == it->second.symbols.begin() ? &unresolved : &(--symbol)->second;
+        }
+
+        /// PRIV: Call fn(callee, caller or nullptr) for every consistent sample in ring
+        template <typename Fn>
+        void for_each_sample(Fn&& fn) const
+        {
+            static std::string const host = "<host>";
+
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            auto const end = m_write_index.load(std::memory_order_acquire);
+            auto const begin = std::max(m_read_index.load(std::memory_order_acquire), end > s_ring_capacity ? end - s_ring_capacity : 0);
+
+            for (auto index = begin; index < end; ++index)
+            {
+                auto const& sample = m_samples[index % s_ring_capacity];
+
+                if (sample.seq.load(std::memory_order_acquire) != index + 1)
+                {
+                    continue;
+                }
+
+                auto const pc = sample.pc.load(std::memory_order_relaxed);
+                auto const caller_pc = sample.caller.load(std::memory_order_relaxed);
+
+                if (sample.seq.load(std::memory_order_acquire) != index + 1)
+                {
+                    continue;
+                }
+
+                auto const callee = find_function(pc);
+                auto const caller = callee != nullptr && caller_pc != 0 ? find_function(caller_pc) : nullptr;
+
+                fn(callee != nullptr ? *callee : host, callee != nullptr && caller_pc != 0 ? (caller != nullptr ? caller : &host) : nullptr);
+            }
+        }
+
+        std::unique_ptr<Sample[]> m_samples;
+        std::atomic<std::size_t> m_write_index;
+        std::atomic<std::size_t> m_read_index;
+        std::atomic<bool> m_is_running;
+        Range m_ranges[s_ranges_capacity] = {};
+        mutable std::mutex m_mutex;
+        std::map<uintptr_t, Image> m_images;
+        bool m_has_handler;
+        struct sigaction m_previous_action = {};
+        std::vector<timer_t> m_timers;
+    };
+
+    #endif
+
+    namespace priv
+    {
+        /// Notify profiler about compiled code, no-op without TW_USE_PROFILER
+        inline void on_image_created([[maybe_unused]] void const* image, [[maybe_unused]] std::size_t size) noexcept
+        {
+            #if defined(TW_USE_PROFILER)
+            try
+            {
+                Profiler::get().add_image(image, size);
+            }
+            catch (...)
+            {
+            }
+            #endif
+        }
+
+        /// Notify profiler that compiled code is about to be freed, no-op without TW_USE_PROFILER
+        inline void on_image_released([[maybe_unused]] void const* image) noexcept
+        {
+            #if defined(TW_USE_PROFILER)
+            try
+            {
+                Profiler::get().remove_image(image);
+            }
+            catch (...)
+            {
+            }
+            #endif
+        }
+
+        /// Notify profiler about resolved symbol, no-op without TW_USE_PROFILER
+        inline void on_symbol_found([[maybe_unused]] void const* image, [[maybe_unused]] char const* name, [[maybe_unused]] void const* symbol) noexcept
+        {
+            #if defined(TW_USE_PROFILER)
+            if (image != nullptr && symbol != nullptr)
+            {
+                try
+                {
+                    Profiler::get().add_symbol(image, name, symbol);
+                }
+                catch (...)
+                {
+                }
+            }
+            #endif
+        }
+    }
+
+    #if defined(TW_USE_MEMORY_OUTPUT)
+
+    namespace priv
+    {
+        /// Memory-backed file that tcc can open by path
+        /// On Linux data lives in memfd reached through /proc/self/fd (and symlink in /dev/shm when extension is needed),
+        /// elsewhere it falls back to temporary file removed on destruction
+        class ScratchFile
+        {
+        public:
+
+            /// Create empty file, extension (like ".o") is needed only when tcc detects file type by name
+            explicit ScratchFile(char const* extension = "")
+            {
+                #if defined(__linux__)
+                m_fd = memfd_create("tw_scratch", MFD_CLOEXEC);
+
+                if (m_fd == -1)
+                {
+                    return;
+                }
+
+                m_path = "/proc/self/fd/" + std::to_string(m_fd);
+
+                if (*extension != '\0')
+                {
+                    std::error_code ec;
+
+                    auto link = std::filesystem::path{ "/dev/shm" } / make_unique_name(extension);
+
+                    std::filesystem::create_symlink(m_path, link, ec);
+
+                    if (ec)
+                    {
+                        link = std::filesystem::temp_directory_path(ec) / make_unique_name(extension);
+
+                        std::filesystem::create_symlink(m_path, link, ec);
+                    }
+
+                    m_link = ec ? std::filesystem::path{} : link;
+                    m_path = ec ? std::string{} : link.string();
+                }
+                #else
+                std::error_code ec;
+
+                m_link = std::filesystem::temp_directory_path(ec) / make_unique_name(extension);
+                m_path = ec ? std::string{} : m_link.string();
+                #endif
+            }
+
+            /// Deleted copy-ctor
+            ScratchFile(ScratchFile const&) = delete;
+
+            /// Deleted copy-assign-op
+            ScratchFile& operator=(ScratchFile const&) = delete;
+
+            /// Remove file
+            ~ScratchFile() noexcept
+            {
+                if (!m_link.empty())
+                {
+                    std::error_code ec;
+
+                    std::filesystem::remove(m_link, ec);
+                }
+
+                #if defined(__linux__)
+                if (m_fd != -1)
+                {
+                    close(m_fd);
+                }
+                #endif
+            }
+
+            /// Return path to open file with or empty string if file could not be created
+            std::string const& get_path() const noexcept
+            {
+                return m_path;
+            }
+
+            /// Replace content with given data, return true on success
+            bool write(void const* data, std::size_t size) const
+            {
+                #if defined(__linux__)
+                auto const bytes = static_cast<char const*>(data);
+
+                for (std::size_t offset = 0; offset < size; )
+                {
+                    auto const written = pwrite(m_fd, bytes + offset, size - offset, static_cast<off_t>(offset));
+
+                    if (written <= 0)
+                    {
+                        return false;
+                    }
+
+                    offset += static_cast<std::size_t>(written);
+                }
+
+                return ftruncate(m_fd, static_cast<off_t>(size)) == 0;
+                #else
+                std::ofstream file{ m_link, std::ios::binary | std::ios::trunc };
+
+                file.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+
+                return static_cast<bool>(file);
+                #endif
+            }
+
+            /// Pass content to fn(user_data, chunk, chunk_size) in chunks, return true on success
+            template <typename Fn>
+            bool read(Fn&& fn) const
+            {
+                char chunk[64 * 1024];
+
+                #if defined(__linux__)
+                for (off_t offset = 0; ; )
+                {
+                    auto const received = pread(m_fd, chunk, sizeof(chunk), offset);
+
+                    if (received < 0)
+                    {
+                        return false;
+                    }
+
+                    if (received == 0)
+                    {
+                        return true;
+                    }
+
+                    fn(static_cast<void const*>(chunk), static_cast<std::size_t>(received));
+
+                    offset += received;
+                }
+                #else
+                std::ifstream file{ m_link, std::ios::binary };
+
+                while (file)
+                {
+                    file.read(chunk, sizeof(chunk));
+
+                    if (auto const received = file.gcount(); received > 0)
+                    {
+                        fn(static_cast<void const*>(chunk), static_cast<std::size_t>(received));
+                    }
+                }
+
+                return file.eof();
+                #endif
+            }
+
+        private:
+
+            /// PRIV: Return file name unique within machine (process id keeps processes sharing temp directory apart)
+            static std::string make_unique_name(char const* extension)
+            {
+                static std::atomic<uint32_t> counter{ 0 };
+
+                #if defined(_WIN32)
+                auto const pid = _getpid();
+                #else
+                auto const pid = getpid();
+                #endif
+
+                auto const id = std::chrono::steady_clock::now().time_since_epoch().count();
+
+                return "tw_" + std::to_string(pid) + "_" + std::to_string(id) + "_" + std::to_string(counter.fetch_add(1)) + extension;
+            }
+
+            #if defined(__linux__)
+            int m_fd = -1;
+            #endif
+            std::filesystem::path m_link;
+            std::string m_path;
+        };
+    }
+
+    #endif
+
+    /// Wrapper around tcc state with set of useful methods
+    class TccWrapper
+    {
+    public:
+
+        using State_t   = TCCState*;
+        using ErrorFn_t = void (*)(void* user_data, char const* msg);
+        using SinkFn_t  = void (*)(void* user_data, void const* data, std::size_t size);
+
+        /// Create wrapper object from (possibly) existing state
+        static TccWrapper from(State_t state)
+        {
+            return TccWrapper{ state };
+        }
+
+        /// Deleted named-ctor to prevent construction from nullptr
+        static TccWrapper from(std::nullptr_t) = delete;
+
+        #if defined(TW_USE_EXCEPTIONS)
+
+        /// Create wrapper object with valid state or throw on failure
+        static TccWrapper with_state()
+        {
+            if (auto state = priv::new_state())
+            {
+                return TccWrapper{ state };
+            }
+
+            throw std::runtime_error("TccWrapper::with_state() - unable to create tcc state");
+        }
+
+        #endif
+
+        #if defined(TW_USE_OPTIONAL)
+
+        /// Create optional of wrapper object with valid state or empty optional on failure
+        static std::optional<TccWrapper> opt_with_state()
+        {
+            if (auto state = priv::new_state())
+            {
+                return TccWrapper{ state };
+            }
+
+            return std::nullopt;
+        }
+
+        #endif
+
+        /// Create invalid (without state) wrapper object
+        TccWrapper() noexcept
+            : m_state { nullptr }
+            , m_prelude {}
+            , m_image { nullptr }
+            , m_image_size { 0 }
+        {}
+
+        /// Deleted const copy-ctor
+        TccWrapper(TccWrapper const&) = delete;
+
+        /// Deleted const copy-assign-op
+        TccWrapper& operator=(TccWrapper const&) = delete;
+
+        /// Move-ctor
+        TccWrapper(TccWrapper&& other) noexcept
+            : m_state { std::exchange(other.m_state, nullptr) }
+            , m_prelude { std::exchange(other.m_prelude, {}) }
+            , m_image { std::exchange(other.m_image, nullptr) }
+            , m_image_size { std::exchange(other.m_image_size, 0) }
+        {}
+
+        /// Move-assign-op
+        TccWrapper& operator=(TccWrapper&& other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+
+                m_state = std::exchange(other.m_state, nullptr);
+                m_prelude = std::exchange(other.m_prelude, {});
+                m_image = std::exchange(other.m_image, nullptr);
+                m_image_size = std::exchange(other.m_image_size, 0);
+            }
+
+            return *this;
+        }
+
+        /// Destroy tcc state and compiled code
+        ~TccWrapper() noexcept
+        {
+            release();
+        }
+
+        /// Create (or recreate) tcc state, return true on success
+        bool create_state() noexcept
+        {
+            [[maybe_unused]] priv::TraceScope const scope{ "create_state", m_state };
+
+            release();
+
+            m_state = priv::new_state();
+            m_prelude.clear();
+
+            return is_valid();
+        }
+
+        /// Destroy tcc state and compiled code
+        void destroy_state() noexcept
+        {
+            release();
+
+            m_prelude.clear();
+        }
+
+        /// Set function for printing error messages
+        void set_error_callback(void* user_data, ErrorFn_t fn) const noexcept
+        {
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            tcc_set_error_func(m_state, user_data, fn);
+        }
+
+        /// Set options as from command line (like "-std=c99 -O2")
+        void set_options(char const* options) const noexcept
+        {
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            tcc_set_options(m_state, options);
+        }
+
+        /// Add include path (as with -Ipath)
+        void add_include_path(char const* path) const noexcept
+        {
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            tcc_add_include_path(m_state, path);
+        }
+
+        /// Add system include path (as with -isystem path)
+        void add_system_include_path(char const* path) const noexcept
+        {
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            tcc_add_sysinclude_path(m_state, path);
+        }
+
+        /// Add library path (as with -Lpath)
+        void add_library_path(char const* path) const noexcept
+        {
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            tcc_add_library_path(m_state, path);
+        }
+
+        /// Add library (as with -lname)
+        void add_library(char const* name) const noexcept
+        {
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            tcc_add_library(m_state, name);
+        }
+
+        /// Add file { C file, dll, object, library, ld script } for compilation, return true on success
+        bool add_file(char const* path) const noexcept
+        {
+            [[maybe_unused]] priv::TraceScope const scope{ "add_file", m_state };
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            return tcc_add_file(m_state, path) != -1;
+        }
+
+        /// Add null-terminated string containing C source for compilation (preceded by prelude), return true on success
+        bool add_source_code(char const* src) const
+        {
+            [[maybe_unused]] priv::TraceScope const scope{ "add_source_code", m_state };
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            if (m_prelude.empty())
+            {
+                return tcc_compile_string(m_state, src) != -1;
+            }
+
+            auto const code = m_prelude + "#line 1\n" + src;
+
+            return tcc_compile_string(m_state, code.c_str()) != -1;
+        }
+
+        /// Append C code (usually declarations) to prelude put in front of every source passed to add_source_code, cleared with state
+        void add_prelude(char const* code)
+        {
+            m_prelude += code;
+            m_prelude += '\n';
+        }
+
+        /// Return prelude put in front of every source passed to add_source_code
+        char const* get_prelude() const noexcept
+        {
+            return m_prelude.c_str();
+        }
+
+        /// Compile code to memory, return true on successful relocation, call only once
+        /// With TW_USE_PROFILER code is relocated into memory owned by wrapper (so profiler knows its range) instead of
+        /// memory allocated by tcc, which does not work with tcc configured --with-selinux
+        bool compile() const noexcept
+        {
+            [[maybe_unused]] priv::TraceScope const scope{ "compile", m_state };
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            #if defined(TW_USE_PROFILER)
+            if (m_image != nullptr)
+            {
+                return false;
+            }
+            #endif
+
+            #if defined(TW_USE_EMBEDDED_RUNTIME)
+            priv::runtime::install(m_state);
+            #endif
+
+            tcc_set_output_type(m_state, TCC_OUTPUT_MEMORY);
+
+            #if defined(TW_USE_PROFILER)
+            auto const size = tcc_relocate(m_state, nullptr);
+
+            if (size <= 0)
+            {
+                return false;
+            }
+
+            auto const image = std::malloc(static_cast<std::size_t>(size));
+
+            if (image == nullptr || tcc_relocate(m_state, image) == -1)
+            {
+                std::free(image);
+
+                return false;
+            }
+
+            m_image = image;
+            m_image_size = static_cast<std::size_t>(size);
+
+            priv::on_image_created(m_image, m_image_size);
+
+            return true;
+            #else
+            return tcc_relocate(m_state, TCC_RELOCATE_AUTO) != -1;
+            #endif
+        }
+
+        /// Define macro with given name and optional value (as with #define name value)
+        void define(char const* name, char const* value = nullptr) const noexcept
+        {
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            tcc_define_symbol(m_state, name, value);
+        }
+
+        /// Undefine macro with given name (as with #undef name)
+        void undefine(char const* name) const noexcept
+        {
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            tcc_undefine_symbol(m_state, name);
+        }
+
+        /// Add symbol with given name
+        void add_symbol(char const* name, void const* symbol) const noexcept
+        {
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            tcc_add_symbol(m_state, name, symbol);
+        }
+
+        /// Return void pointer to symbol with given name or nullptr if no such symbol exists
+        void* get_symbol(char const* name) const noexcept
+        {
+            [[maybe_unused]] priv::TraceScope const scope{ "get_symbol", m_state };
+
+            auto const symbol = tcc_get_symbol(m_state, name);
+
+            priv::on_symbol_found(m_image, name, symbol);
+
+            return symbol;
+        }
+
+        /// Return T pointer to symbol with given name or nullptr if no such symbol exists
+        template <typename T>
+        T* get_symbol_as(char const* name) const noexcept
+        {
+            return priv::bit_cast<T*>(get_symbol(name));
+        }
+
+        /// Check if symbol with given name exists
+        bool has_symbol(char const* name) const noexcept
+        {
+            return get_symbol(name) != nullptr;
+        }
+
+        /// Register symbol from parameter as free function with given name, won't override if called multiple times
+        template <typename FP>
+        void register_function(char const* name, FP fn) const noexcept
+        {
+            if constexpr (priv::traits::FunctionPtr_v<FP>)
+            {
+                [[maybe_unused]] priv::CompileLock const lock{};
+
+                tcc_add_symbol(m_state, name, priv::bit_cast<void const*>(fn));
+            }
+            else
+            {
+                static_assert(priv::error<FP>, "FP is not a function pointer!");
+            }
+        }
+
+        /// Register symbol as free function with given name, won't override if called multiple times
+        template <typename F, F vFunctionPtr>
+        void register_function(char const* name) const noexcept
+        {
+            register_function(name, vFunctionPtr);
+        }
+
+        /// Register symbol as free function with given name, won't override if called multiple times
+        template <auto vFunctionPtr>
+        void register_function(char const* name) const noexcept
+        {
+            register_function(name, vFunctionPtr);
+        }
+
+        /// Register symbol as class method with given name, won't override if called multiple times
+        template <typename MP, MP vMethodPtr>
+        void register_method(char const* name) const noexcept
+        {
+            if constexpr (priv::traits::MethodPtr_v<MP>)
+            {
+                register_function(name, priv::as_free_function<MP, vMethodPtr>());
+            }
+            else
+            {
+                static_assert(priv::error<MP>, "MP is not a method pointer!");
+            }
+        }
+
+        /// Register symbol as class method with given name, won't override if called multiple times
+        template <auto vMethodPtr>
+        void register_method(char const* name) const noexcept
+        {
+            register_method<decltype(vMethodPtr), vMethodPtr>(name);
+        }
+
+        #if defined(TW_USE_KERNELS)
+
+        /// Register vectorized array kernels (tw_sum_f64, tw_dot_f64, ...) and add their prototypes to prelude
+        /// Prelude applies only to add_source_code, files passed to add_file must declare kernels themselves (see kernels::prelude),
+        /// otherwise tcc declares them implicitly as returning int and silently truncates results
+        void register_kernels()
+        {
+            register_function("tw_sum_f64", &kernels::sum_f64);
+            register_function("tw_dot_f64", &kernels::dot_f64);
+            register_function("tw_min_f64", &kernels::min_f64);
+            register_function("tw_max_f64", &kernels::max_f64);
+            register_function("tw_fma_f64", &kernels::fma_f64);
+            register_function("tw_gather_f64", &kernels::gather_f64);
+            register_function("tw_filter_gt_f64", &kernels::filter_gt_f64);
+            register_function("tw_prefix_sum_f64", &kernels::prefix_sum_f64);
+
+            add_prelude(kernels::prelude);
+        }
+
+        #endif
+
+        /// Return F pointer to function with given name or nullptr if no such symbol exists
+        template <typename F>
+        auto get_function(char const* name) const noexcept
+        {
+            if constexpr (priv::traits::Function_v<F>)
+            {
+                return get_symbol_as<F>(name);
+            }
+            else
+            {
+                static_assert(priv::error<F>, "F is not a function!");
+            }
+        }
+
+        #if defined(TW_USE_EXCEPTIONS)
+
+        /// Try to invoke function with given args, return result, throw if no such function symbol exists
+        template <typename F, typename... Args>
+        auto invoke(char const* name, Args&&... args) const
+        {
+            if constexpr (priv::traits::Function_v<F>)
+            {
+                if constexpr (priv::traits::InvokableWith_v<F, Args...>)
+                {
+                    auto const symbol = get_function<F>(name);
+
+                    if (symbol != nullptr)
+                    {
+                        [[maybe_unused]] priv::TraceScope const scope{ "invoke", m_state };
+
+                        return (*symbol)(std::forward<Args>(args)...);
+                    }
+
+                    throw std::runtime_error(std::string{ "TccWrapper::invoke() - unable to find symbol with given name: " } + name);
+                }
+                else
+                {
+                    static_assert(priv::error<F, Args...>, "F is not invokable with given Args!");
+                }
+            }
+            else
+            {
+                static_assert(priv::error<F>, "F is not a function!");
+            }
+        }
+
+        #endif
+
+        #if defined(TW_USE_OPTIONAL)
+
+        /// Try to invoke function with given args, return optional with call result (with value or empty)
+        template <typename F, typename... Args>
+        auto opt_invoke(char const* name, Args&&... args) const
+        {
+            if constexpr (priv::traits::Function_v<F>)
+            {
+                if constexpr (priv::traits::InvokableWith_v<F, Args...>)
+                {
+                    using Optional_t = std::optional<std::decay_t<std::invoke_result_t<F*, Args...>>>;
+
+                    auto const symbol = get_function<F>(name);
+
+                    if (symbol != nullptr)
+                    {
+                        [[maybe_unused]] priv::TraceScope const scope{ "invoke", m_state };
+
+                        return Optional_t{ (*symbol)(std::forward<Args>(args)...) };
+                    }
+
+                    return Optional_t{};
+                }
+                else
+                {
+                    static_assert(priv::error<F, Args...>, "F is not invokable with given Args!");
+                }
+            }
+            else
+            {
+                static_assert(priv::error<F>, "F is not a function!");
+            }
+        }
+
+        #endif
+
+        #if defined(TW_USE_EXECUTOR)
+
+        /// Invoke function with copies of given args on default executor, return future with call result, future throws if no such function symbol exists
+        /// Task holds raw pointer to compiled code, so wrapper (and its state) must outlive it, wait on future before destroying wrapper
+        template <typename F, typename... Args>
+        auto invoke_async(char const* name, Args&&... args) const
+        {
+            return invoke_async<F>(Executor::get_default(), name, std::forward<Args>(args)...);
+        }
+
+        /// Invoke function with copies of given args on given executor, return future with call result, future throws if no such function symbol exists
+        /// Task holds raw pointer to compiled code, so wrapper (and its state) must outlive it, wait on future before destroying wrapper
+        template <typename F, typename... Args>
+        auto invoke_async(Executor& executor, char const* name, Args&&... args) const
+        {
+            if constexpr (priv::traits::Function_v<F>)
+            {
+                if constexpr (priv::traits::InvokableWith_v<F, Args...>)
+                {
+                    using Ret_t = std::invoke_result_t<F, Args...>;
+
+                    auto const symbol = get_function<F>(name);
+
+                    if (symbol == nullptr)
+                    {
+                        std::promise<Ret_t> promise;
+                        promise.set_exception(std::make_exception_ptr(std::runtime_error(std::string{ "TccWrapper::invoke_async() - unable to find symbol with given name: " } + name)));
+
+                        return promise.get_future();
+                    }
+
+                    auto task = std::make_shared<std::packaged_task<Ret_t()>>(
+                        [symbol, state = m_state, tuple = std::make_tuple(std::forward<Args>(args)...)]() mutable -> Ret_t {
+                            [[maybe_unused]] priv::TraceScope const scope{ "invoke", state };
+
+                            return std::apply(*symbol, std::move(tuple));
+                        }
+                    );
+
+                    auto future = task->get_future();
+
+                    executor.submit([task] { (*task)(); });
+
+                    return future;
+                }
+                else
+                {
+                    static_assert(priv::error<F, Args...>, "F is not invokable with given Args!");
+                }
+            }
+            else
+            {
+                static_assert(priv::error<F>, "F is not a function!");
+            }
+        }
+
+        /// Split range into chunks of grain indices (0 for automatic) and invoke function as fn(begin, end) for each on default executor, throw if no such function symbol exists
+        template <typename F>
+        void parallel_invoke(char const* name, Range range, std::size_t grain) const
+        {
+            parallel_invoke<F>(Executor::get_default(), name, range, grain);
+        }
+
+        /// Split range into chunks of grain indices (0 for automatic) and invoke function as fn(begin, end) for each on given executor, throw if no such function symbol exists
+        template <typename F>
+        void parallel_invoke(Executor& executor, char const* name, Range range, std::size_t grain) const
+        {
+            parallel_invoke<F>(executor, name, range, grain, 0, [](int acc, auto&&) { return acc; });
+        }
+
+        /// Same as parallel_invoke on default executor, but fold chunk results in range order as acc = reduce(acc, result) starting from init
+        template <typename F, typename T, typename ReduceFn>
+        T parallel_invoke(char const* name, Range range, std::size_t grain, T init, ReduceFn reduce) const
+        {
+            return parallel_invoke<F>(Executor::get_default(), name, range, grain, std::move(init), std::move(reduce));
+        }
+
+        /// Same as parallel_invoke on given executor, but fold chunk results in range order as acc = reduce(acc, result) starting from init
+        template <typename F, typename T, typename ReduceFn>
+        T parallel_invoke(Executor& executor, char const* name, Range range, std::size_t grain, T init, ReduceFn reduce) const
+        {
+            if constexpr (priv::traits::Function_v<F>)
+            {
+                if constexpr (priv::traits::InvokableWith_v<F, std::size_t, std::size_t>)
+                {
+                    using Ret_t = std::invoke_result_t<F, std::size_t, std::size_t>;
+                    using Partial_t = std::conditional_t<std::is_void_v<Ret_t>, char, Ret_t>;
+
+                    auto const symbol = get_function<F>(name);
+
+                    if (symbol == nullptr)
+                    {
+                        throw std::runtime_error(std::string{ "TccWrapper::parallel_invoke() - unable to find symbol with given name: " } + name);
+                    }
+
+                    if (range.end <= range.begin)
+                    {
+                        return init;
+                    }
+
+                    auto const size = range.end - range.begin;
+
+                    if (grain == 0)
+                    {
+                        grain = std::max<std::size_t>(size / (executor.get_workers_count() * 4), 1);
+                    }
+
+                    grain = std::min(grain, size);
+
+                    auto const chunks_count = (size + grain - 1) / grain;
+
+                    std::vector<Partial_t> partials(chunks_count);
+                    std::atomic<std::size_t> remaining{ chunks_count };
+
+                    auto const run_chunk = [&, symbol](std::size_t chunk) {
+                        [[maybe_unused]] priv::TraceScope const scope{ "invoke", m_state };
+
+                        auto const begin = range.begin + chunk * grain;
+                        auto const end = begin + std::min(grain, range.end - begin);
+
+                        if constexpr (std::is_void_v<Ret_t>)
+                        {
+                            (*symbol)(begin, end);
+                        }
+                        else
+                        {
+                            partials[chunk] = (*symbol)(begin, end);
+                        }
+
+                        remaining.fetch_sub(1, std::memory_order_release);
+                    };
+
+                    std::size_t submitted = 1;
+
+                    try
+                    {
+                        for (; submitted < chunks_count; ++submitted)
+                        {
+                            executor.submit([&run_chunk, chunk = submitted] { run_chunk(chunk); });
+                        }
+                    }
+                    catch (...)
+                    {
+                        // queued chunks reference this frame, wait for them before unwinding (chunk 0 and unsubmitted ones never run)
+                        remaining.fetch_sub(chunks_count - submitted + 1, std::memory_order_release);
+
+                        executor.help_until([&remaining] { return remaining.load(std::memory_order_acquire) == 0; });
+
+                        throw;
+                    }
+
+                    run_chunk(0);
+
+                    executor.help_until([&remaining] { return remaining.load(std::memory_order_acquire) == 0; });
+
+                    if constexpr (!std::is_void_v<Ret_t>)
+                    {
+                        for (auto& partial : partials)
+                        {
+                            init = reduce(std::move(init), partial);
+                        }
+                    }
+
+                    return init;
+                }
+                else
+                {
+                    static_assert(priv::error<F>, "F is not invokable with (size_t begin, size_t end)!");
+                }
+            }
+            else
+            {
+                static_assert(priv::error<F>, "F is not a function!");
+            }
+        }
+
+        #endif
+
+        /// Output file depending on output_type, return true on success
+        bool output_file(char const* filename, OutputType output_type) const noexcept
+        {
+            [[maybe_unused]] priv::CompileLock const lock{};
+
+            tcc_set_output_type(m_state, static_cast<int32_t>(output_type));
+
+            return tcc_output_file(m_state, filename) != -1;
+        }
+
+        #if defined(TW_USE_MEMORY_OUTPUT)
+
+        /// Output image depending on output_type to memory, return image or empty vector on failure
+        std::vector<uint8_t> output_to_memory(OutputType output_type) const
+        {
+            std::vector<uint8_t> image;
+
+            auto const sink = [](void* user_data, void const* data, std::size_t size) {
+                auto& buffer = *static_cast<std::vector<uint8_t>*>(user_data);
+                auto const bytes = static_cast<uint8_t const*>(data);
+
+                buffer.insert(buffer.end(), bytes, bytes + size);
+            };
+
+            if (!output_to_memory(output_type, &image, sink))
+            {
+                image.clear();
+            }
+
+            return image;
+        }
+
+        /// Output image depending on output_type to memory and pass it to fn in chunks, return true on success
+        bool output_to_memory(OutputType output_type, void* user_data, SinkFn_t fn) const
+        {
+            priv::ScratchFile const file;
+
+            if (file.get_path().empty())
+            {
+                return false;
+            }
+
+            {
+                [[maybe_unused]] priv::CompileLock const lock{};
+
+                tcc_set_output_type(m_state, static_cast<int32_t>(output_type));
+
+                if (tcc_output_file(m_state, file.get_path().c_str()) == -1)
+                {
+                    return false;
+                }
+            }
+
+            return file.read([user_data, fn](void const* data, std::size_t size) { fn(user_data, data, size); });
+        }
+
+        /// Add image { object, library archive } from memory for linking, return true on success
+        /// Dlls are not supported: tcc records them by name of temporary file, which is removed before linking
+        bool add_object_from_memory(void const* data, std::size_t size) const
+        {
+            priv::ScratchFile const file{ ".o" };
+
+            if (file.get_path().empty() || !file.write(data, size))
+            {
+                return false;
+            }
+
+            return add_file(file.get_path().c_str());
+        }
+
+        #endif
+
+        /// Return true if internal state is valid (not nullptr)
+        bool is_valid() const noexcept
+        {
+            return m_state != nullptr;
+        }
+
+        /// Return internal state on which wrapper operates
+        State_t get_state() const noexcept
+        {
+            return m_state;
+        }
+
+        #if defined(TW_USE_PROFILER)
+
+        /// Return memory with compiled code and data (owned by wrapper with TW_USE_PROFILER) or nullptr before successful compile
+        void const* get_image() const noexcept
+        {
+            return m_image;
+        }
+
+        /// Return size of memory with compiled code and data in bytes or 0 before successful compile
+        std::size_t get_image_size() const noexcept
+        {
+            return m_image_size;
+        }
+
+        #endif
+
+    private:
+
+        /// PRIV: Internal private ctor
+        TccWrapper(State_t state) noexcept
+            : m_state { state }
+            , m_prelude {}
+            , m_image { nullptr }
+            , m_image_size { 0 }
+        {
+
+        }
+
+        /// PRIV: Delete state and free compiled code
+        void release() noexcept
+        {
+            if (m_image != nullptr)
+            {
+                priv::on_image_released(m_image);
             }
-            else
+
+            if (is_valid())
             {
-                static_assert(priv::error<F>, "F is not a function!");
+                priv::delete_state(m_state);
+
+                m_state = nullptr;
             }
+
+            std::free(m_image);
+
+            m_image = nullptr;
+            m_image_size = 0;
         }
 
-        #if defined(TW_USE_EXCEPTIONS)
+        State_t m_state;
+        std::string m_prelude;
+        mutable void* m_image;
+        mutable std::size_t m_image_size;
+    };
 
-        /// Try to invoke function with given args, return result, throw if no such function symbol exists
-        template <typename F, typename... Args>
-        auto invoke(char const* name, Args&&... args) const
+    #if defined(TW_USE_WARMUP)
+
+    /// Recorder of compile working set (sources with options and their use counts) saved to compact manifest file
+    class WarmupManifest
+    {
+    public:
+
+        /// Kind of recorded source
+        enum class Kind : char
         {
-            if constexpr (priv::traits::Function_v<F>)
+            Source = 's',
+            File = 'f',
+        };
+
+        /// Single recorded compilation
+        struct Entry
+        {
+            Kind kind;
+            std::string options;
+            std::string source;
+            uint64_t uses;
+        };
+
+        /// Create empty manifest
+        WarmupManifest() = default;
+
+        /// Deleted copy-ctor
+        WarmupManifest(WarmupManifest const&) = delete;
+
+        /// Deleted copy-assign-op
+        WarmupManifest& operator=(WarmupManifest const&) = delete;
+
+        /// Record use of C source compiled with given options (like "-DN=4 -O2")
+        void record_source(char const* src, char const* options = "")
+        {
+            record(Kind::Source, src, options);
+        }
+
+        /// Record use of file compiled with given options (like "-DN=4 -O2")
+        void record_file(char const* path, char const* options = "")
+        {
+            record(Kind::File, path, options);
+        }
+
+        /// Return entries sorted from most used
+        std::vector<Entry> get_entries() const
+        {
+            uint64_t generation;
+
+            return get_entries(generation);
+        }
+
+        /// Return number of distinct recorded entries
+        std::size_t get_entries_count() const
+        {
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            return m_entries.size();
+        }
+
+        /// Remove all entries
+        void clear()
+        {
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            m_entries.clear();
+            ++m_generation;
+        }
+
+        /// Write entries sorted from most used to file (replaced atomically), return true on success
+        bool save(char const* path)
+        {
+            // saves share temporary file name, so they are serialized (recording is not blocked meanwhile)
+            std::lock_guard<std::mutex> const save_lock{ m_save_mutex };
+
+            uint64_t generation;
+            auto const entries = get_entries(generation);
+            auto const temp_path = std::string{ path } + ".tmp";
+
             {
-                if constexpr (priv::traits::InvokableWith_v<F, Args...>)
-                {
-                    auto const symbol = get_function<F>(name);
+                std::ofstream file{ temp_path, std::ios::binary | std::ios::trunc };
 
-                    if (symbol != nullptr)
-                    {
-                        return (*symbol)(std::forward<Args>(args)...);
-                    }
+                file << "TWWM 1\n";
 
-                    throw std::runtime_error(std::string{ "TccWrapper::invoke() - unable to find symbol with given name: " } + name);
+                for (auto const& entry : entries)
+                {
+                    file << entry.uses << ' ' << static_cast<char>(entry.kind) << ' ' << entry.options.size() << ' ' << entry.source.size() << '\n';
+                    file << entry.options << entry.source << '\n';
                 }
-                else
+
+                if (!file.flush())
                 {
-                    static_assert(priv::error<F, Args...>, "F is not invokable with given Args!");
+                    return false;
                 }
             }
-            else
+
+            std::error_code ec;
+
+            std::filesystem::rename(temp_path, path, ec);
+
+            if (ec)
             {
-                static_assert(priv::error<F>, "F is not a function!");
+                std::filesystem::remove(temp_path, ec);
+
+                return false;
             }
+
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            // entries recorded since snapshot keep manifest dirty
+            m_saved_generation = generation;
+            m_last_save = std::chrono::steady_clock::now();
+
+            return true;
         }
 
-        #endif
+        /// Save to file if anything was recorded and at least interval passed since last save (cheap to call often), return true if saved
+        bool save_periodically(char const* path, std::chrono::seconds interval)
+        {
+            {
+                std::lock_guard<std::mutex> const lock{ m_mutex };
 
-        #if defined(TW_USE_OPTIONAL)
+                if (m_generation == m_saved_generation || std::chrono::steady_clock::now() - m_last_save < interval)
+                {
+                    return false;
+                }
 
-        /// Try to invoke function with given args, return optional with call result (with value or empty)
-        template <typename F, typename... Args>
-        auto opt_invoke(char const* name, Args&&... args) const
+                m_last_save = std::chrono::steady_clock::now();
+            }
+
+            return save(path);
+        }
+
+        /// Read entries from file adding their uses to already recorded ones, return true on success
+        bool load(char const* path)
         {
-            if constexpr (priv::traits::Function_v<F>)
+            std::ifstream file{ path, std::ios::binary };
+            std::string header;
+
+            if (!std::getline(file, header) || header != "TWWM 1")
             {
-                if constexpr (priv::traits::InvokableWith_v<F, Args...>)
+                return false;
+            }
+
+            std::vector<Entry> entries;
+
+            for (;;)
+            {
+                uint64_t uses;
+                char kind;
+                std::size_t options_size;
+                std::size_t source_size;
+
+                if (!(file >> uses))
                 {
-                    auto const symbol = get_function<F>(name);
+                    break;
+                }
 
-                    return symbol != nullptr ? std::make_optional((*symbol)(std::forward<Args>(args)...)) : std::nullopt;
+                if (!(file >> kind >> options_size >> source_size) || file.get() != '\n' || (kind != 's' && kind != 'f'))
+                {
+                    return false;
                 }
-                else
+
+                Entry entry{ static_cast<Kind>(kind), std::string(options_size, '\0'), std::string(source_size, '\0'), uses };
+
+                if (!file.read(entry.options.data(), static_cast<std::streamsize>(options_size)) ||
+                    !file.read(entry.source.data(), static_cast<std::streamsize>(source_size)) ||
+                    file.get() != '\n')
                 {
-                    static_assert(priv::error<F, Args...>, "F is not invokable with given Args!");
+                    return false;
                 }
+
+                entries.push_back(std::move(entry));
             }
-            else
+
+            if (!file.eof())
             {
-                static_assert(priv::error<F>, "F is not a function!");
+                return false;
+            }
+
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            for (auto& entry : entries)
+            {
+                auto key = make_key(entry.kind, entry.source.c_str(), entry.options.c_str());
+                auto const [it, is_inserted] = m_entries.try_emplace(std::move(key), std::move(entry));
+
+                if (!is_inserted)
+                {
+                    it->second.uses += entry.uses;
+                }
             }
+
+            return true;
         }
 
-        #endif
+    private:
 
-        /// Output file depending on output_type, return true on success
-        bool output_file(char const* filename, OutputType output_type) const noexcept
+        friend class WarmupReplayer;
+
+        /// PRIV: Return key identifying source with options
+        static std::string make_key(Kind kind, char const* source, char const* options)
         {
-            tcc_set_output_type(m_state, static_cast<int32_t>(output_type));
+            std::string key;
+            key += static_cast<char>(kind);
+            key += options;
+            key += '\0';
+            key += source;
 
-            return tcc_output_file(m_state, filename) != -1;
+            return key;
         }
 
-        /// Return true if internal state is valid (not nullptr)
-        bool is_valid() const noexcept
+        /// PRIV: Return entries sorted from most used together with generation of that snapshot
+        std::vector<Entry> get_entries(uint64_t& generation) const
         {
-            return m_state != nullptr;
+            std::vector<Entry> entries;
+
+            {
+                std::lock_guard<std::mutex> const lock{ m_mutex };
+
+                generation = m_generation;
+                entries.reserve(m_entries.size());
+
+                for (auto const& [key, entry] : m_entries)
+                {
+                    entries.push_back(entry);
+                }
+            }
+
+            std::stable_sort(entries.begin(), entries.end(), [](Entry const& lhs, Entry const& rhs) {
+                return lhs.uses > rhs.uses;
+            });
+
+            return entries;
         }
 
-        /// Return internal state on which wrapper operates
-        State_t get_state() const noexcept
+        /// PRIV: Increment uses of entry, insert if missing
+        void record(Kind kind, char const* source, char const* options)
         {
-            return m_state;
+            auto key = make_key(kind, source, options);
+
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            auto it = m_entries.find(key);
+
+            if (it == m_entries.end())
+            {
+                it = m_entries.emplace(std::move(key), Entry{ kind, options, source, 0 }).first;
+            }
+
+            ++it->second.uses;
+            ++m_generation;
+        }
+
+        mutable std::mutex m_mutex;
+        std::mutex m_save_mutex;
+        std::unordered_map<std::string, Entry> m_entries;
+        std::chrono::steady_clock::time_point m_last_save = std::chrono::steady_clock::now();
+        uint64_t m_generation = 0;
+        uint64_t m_saved_generation = 0;
+    };
+
+    /// Background compiler of manifest entries (most used first) handing out warm wrappers to first requests
+    class WarmupReplayer
+    {
+    public:
+
+        using SetupFn_t = void (*)(void* user_data, TccWrapper& tcc);
+
+        /// How much of working set is compiled
+        struct Report
+        {
+            std::size_t entries_count = 0;
+            std::size_t warm_count = 0;
+            std::size_t failed_count = 0;
+            uint64_t uses_count = 0;
+            uint64_t warm_uses_count = 0;
+            std::chrono::nanoseconds elapsed{ 0 };
+
+            /// Return part of recorded uses covered by warm entries (1 for empty working set)
+            double get_warm_ratio() const noexcept
+            {
+                return uses_count == 0 ? 1.0 : static_cast<double>(warm_uses_count) / static_cast<double>(uses_count);
+            }
+        };
+
+        /// Create idle replayer
+        WarmupReplayer() = default;
+
+        /// Deleted copy-ctor
+        WarmupReplayer(WarmupReplayer const&) = delete;
+
+        /// Deleted copy-assign-op
+        WarmupReplayer& operator=(WarmupReplayer const&) = delete;
+
+        /// Stop compiling and destroy warm wrappers
+        ~WarmupReplayer() noexcept
+        {
+            stop();
+        }
+
+        /// Set function called on each fresh state before its source is added (to register symbols, paths, ...), call before start
+        /// It runs on background thread while other threads may compile, so it must configure state only through wrapper methods
+        /// (they take compile lock), never by tcc calls on get_state()
+        void set_setup_callback(void* user_data, SetupFn_t fn) noexcept
+        {
+            m_setup_user_data = user_data;
+            m_setup_fn = fn;
+        }
+
+        /// Start compiling at most max_entries (0 for all) most used manifest entries on background thread, return true on success
+        bool start(WarmupManifest const& manifest, std::size_t max_entries = 0)
+        {
+            if (m_thread.joinable())
+            {
+                return false;
+            }
+
+            auto entries = manifest.get_entries();
+
+            if (max_entries != 0 && entries.size() > max_entries)
+            {
+                entries.resize(max_entries);
+            }
+
+            {
+                std::lock_guard<std::mutex> const lock{ m_mutex };
+
+                m_slots.clear();
+                m_report = Report{};
+                m_first_request_report = Report{};
+                m_has_first_request = false;
+                m_report.entries_count = entries.size();
+
+                for (auto const& entry : entries)
+                {
+                    m_report.uses_count += entry.uses;
+                }
+            }
+
+            m_is_stopping.store(false, std::memory_order_relaxed);
+            m_start_time = std::chrono::steady_clock::now();
+            m_thread = std::thread{ &WarmupReplayer::run, this, std::move(entries) };
+
+            return true;
+        }
+
+        /// Stop compiling after current entry, keep already warm wrappers
+        void stop() noexcept
+        {
+            m_is_stopping.store(true, std::memory_order_relaxed);
+
+            wait();
+        }
+
+        /// Block until all entries are processed or replay is stopped
+        void wait() noexcept
+        {
+            if (m_thread.joinable())
+            {
+                m_thread.join();
+            }
+        }
+
+        /// Take compiled wrapper for C source with given options or return invalid wrapper if it is not warm (yet)
+        TccWrapper take_source(char const* src, char const* options = "")
+        {
+            return take(WarmupManifest::make_key(WarmupManifest::Kind::Source, src, options));
+        }
+
+        /// Take compiled wrapper for file with given options or return invalid wrapper if it is not warm (yet)
+        TccWrapper take_file(char const* path, char const* options = "")
+        {
+            return take(WarmupManifest::make_key(WarmupManifest::Kind::File, path, options));
+        }
+
+        /// Return current progress of replay
+        Report get_report() const
+        {
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            auto report = m_report;
+            report.elapsed = std::chrono::steady_clock::now() - m_start_time;
+
+            return report;
+        }
+
+        /// Return progress of replay at moment of first take call or empty report if nothing was taken yet
+        Report get_first_request_report() const
+        {
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            return m_first_request_report;
         }
 
     private:
 
-        /// PRIV: Internal private ctor
-        TccWrapper(State_t state) noexcept
-            : m_state { state }
+        /// PRIV: Compilation result of single manifest entry
+        struct Slot
+        {
+            TccWrapper tcc;
+            uint64_t uses;
+            bool is_taken;
+        };
+
+        /// PRIV: Compile entries in order until done or stopped
+        void run(std::vector<WarmupManifest::Entry> entries)
+        {
+            for (auto const& entry : entries)
+            {
+                if (m_is_stopping.load(std::memory_order_relaxed))
+                {
+                    break;
+                }
+
+                auto key = WarmupManifest::make_key(entry.kind, entry.source.c_str(), entry.options.c_str());
+
+                {
+                    std::lock_guard<std::mutex> const lock{ m_mutex };
+
+                    if (m_slots.count(key) != 0)
+                    {
+                        continue;
+                    }
+                }
+
+                auto tcc = TccWrapper{};
+                auto const is_compiled = compile(tcc, entry);
+
+                std::lock_guard<std::mutex> const lock{ m_mutex };
+
+                if (!is_compiled)
+                {
+                    ++m_report.failed_count;
+
+                    continue;
+                }
+
+                auto const [it, is_inserted] = m_slots.try_emplace(std::move(key), Slot{ std::move(tcc), entry.uses, false });
+
+                if (is_inserted)
+                {
+                    ++m_report.warm_count;
+                    m_report.warm_uses_count += entry.uses;
+                }
+            }
+        }
+
+        /// PRIV: Create state for entry and compile it, return true on success
+        bool compile(TccWrapper& tcc, WarmupManifest::Entry const& entry) const
+        {
+            if (!tcc.create_state())
+            {
+                return false;
+            }
+
+            // each wrapper call takes compile lock, so setup interleaves safely with compilation on request threads
+            if (m_setup_fn != nullptr)
+            {
+                m_setup_fn(m_setup_user_data, tcc);
+            }
+
+            if (!entry.options.empty())
+            {
+                tcc.set_options(entry.options.c_str());
+            }
+
+            auto const is_added = entry.kind == WarmupManifest::Kind::File ? tcc.add_file(entry.source.c_str()) : tcc.add_source_code(entry.source.c_str());
+
+            return is_added && tcc.compile();
+        }
+
+        /// PRIV: Move out warm wrapper for key, mark key as requested so it is not compiled afterwards
+        TccWrapper take(std::string key)
         {
+            std::lock_guard<std::mutex> const lock{ m_mutex };
+
+            if (!m_has_first_request)
+            {
+                m_has_first_request = true;
+                m_first_request_report = m_report;
+                m_first_request_report.elapsed = std::chrono::steady_clock::now() - m_start_time;
+            }
+
+            auto const [it, is_inserted] = m_slots.try_emplace(std::move(key), Slot{ TccWrapper{}, 0, true });
+
+            if (is_inserted || it->second.is_taken)
+            {
+                return TccWrapper{};
+            }
+
+            it->second.is_taken = true;
 
+            return std::move(it->second.tcc);
         }
 
-        State_t m_state;
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::string, Slot> m_slots;
+        Report m_report;
+        Report m_first_request_report;
+        bool m_has_first_request = false;
+        std::atomic<bool> m_is_stopping{ false };
+        std::chrono::steady_clock::time_point m_start_time;
+        std::thread m_thread;
+        void* m_setup_user_data = nullptr;
+        SetupFn_t m_setup_fn = nullptr;
     };
+
+    #endif
 }
 
 #else